@@ -0,0 +1,175 @@
+/*
+    Throughput of .csv loaders against .xlsx ones
+    For every samples_dir/<table>[_small].xlsx:
+    (1) converting it to out_dir/<table>[_small].csv (cells as they are stored in xlsx: dates as serial numbers, text quoted)
+    (2) loading both files 'repeats' times (best time is being reported)
+    (3) checking that loaded objects are the same
+
+    ./benchmark/loaders_benchmark ./../samples /tmp 3
+*/
+#include "params.h"
+#include "trucks.h"
+#include "orders.h"
+#include "distances.h"
+#include "xlsx_stream_reader.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+    // text cells are always quoted (keeps them readable by other tools - CSVReader types quoted field by its content)
+    void WriteCSVField(std::ofstream& out, const std::string& field, bool is_text) {
+        if (!is_text && field.find_first_of(",\"\r\n") == std::string::npos) {
+            out << field;
+            return;
+        }
+        out << '"';
+        for (char ch : field) {
+            if (ch == '"') {
+                out << '"';
+            }
+            out << ch;
+        }
+        out << '"';
+    }
+
+    size_t ConvertXLSXToCSV(const std::string& path_to_xlsx, const std::string& path_to_csv) {
+        XLSXStreamReader reader(path_to_xlsx, "Sheet1");
+        std::ofstream out(path_to_csv, std::ios::trunc);
+        size_t rows = 0;
+        while (reader.NextRow()) {
+            XLSXStreamCell cell = reader.FirstCell();
+            for (bool first = true; !cell.is_end(); cell.next(), first = false) {
+                if (!first) {
+                    out << ',';
+                }
+                WriteCSVField(out, cell.get_value<std::string>(), cell.get_type() == XLValueType::String);
+            }
+            out << '\n';
+            ++rows;
+        }
+        return rows;
+    }
+
+    bool Equal(const Params& a, const Params& b) {
+        return a.speed == b.speed
+            && a.free_km_cost == b.free_km_cost
+            && a.free_hour_cost == b.free_hour_cost
+            && a.wait_cost == b.wait_cost
+            && a.duty_km_cost == b.duty_km_cost
+            && a.duty_hour_cost == b.duty_hour_cost;
+    }
+
+    bool Equal(const Trucks& a, const Trucks& b) {
+        if (a.Size() != b.Size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.Size(); ++i) {
+            const Truck& x = a.GetTruckConst(i);
+            const Truck& y = b.GetTruckConst(i);
+            if (x.truck_id != y.truck_id || x.mask_load_type != y.mask_load_type
+                || x.mask_trailer_type != y.mask_trailer_type
+                || x.init_time != y.init_time || x.init_city != y.init_city) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Equal(const Orders& a, const Orders& b) {
+        if (a.Size() != b.Size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.Size(); ++i) {
+            const Order& x = a.GetOrderConst(i);
+            const Order& y = b.GetOrderConst(i);
+            if (x.order_id != y.order_id || x.obligation != y.obligation
+                || x.start_time != y.start_time || x.finish_time != y.finish_time
+                || x.from_city != y.from_city || x.to_city != y.to_city
+                || x.mask_load_type != y.mask_load_type || x.mask_trailer_type != y.mask_trailer_type
+                || x.distance != y.distance || x.revenue != y.revenue) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Equal(const Distances& a, const Distances& b) {
+        return a.dists == b.dists;
+    }
+
+    // best of 'repeats' loads, returns {seconds, loaded object}
+    template<typename T>
+    std::pair<double, T> Load(const std::string& path, int repeats) {
+        double best = 1e18;
+        T result;
+        for (int it = 0; it < repeats; ++it) {
+            auto start = std::chrono::steady_clock::now();
+            T loaded(path);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            result = std::move(loaded);
+        }
+        return {best, std::move(result)};
+    }
+
+    template<typename T>
+    bool Run(const std::string& name, const std::string& samples_dir, const std::string& out_dir, int repeats) {
+        std::string path_to_xlsx = samples_dir + "/" + name + ".xlsx";
+        std::string path_to_csv = out_dir + "/" + name + ".csv";
+        if (!std::filesystem::exists(path_to_xlsx)) {
+            std::cout << std::setw(16) << name << "  skipped (no " << path_to_xlsx << ")" << std::endl;
+            return true;
+        }
+        size_t rows = ConvertXLSXToCSV(path_to_xlsx, path_to_csv);
+
+        auto [xlsx_seconds, from_xlsx] = Load<T>(path_to_xlsx, repeats);
+        auto [csv_seconds, from_csv] = Load<T>(path_to_csv, repeats);
+        bool equal = Equal(from_xlsx, from_csv);
+
+        std::cout << std::fixed << std::setprecision(4)
+            << std::setw(16) << name
+            << std::setw(10) << rows
+            << std::setw(12) << xlsx_seconds
+            << std::setw(12) << csv_seconds
+            << std::setw(14) << std::setprecision(0) << rows / std::max(xlsx_seconds, 1e-9)
+            << std::setw(14) << rows / std::max(csv_seconds, 1e-9)
+            << std::setw(10) << std::setprecision(1) << xlsx_seconds / std::max(csv_seconds, 1e-9) << "x"
+            << std::setw(8) << (equal ? "same" : "DIFFER")
+            << std::endl;
+        return equal;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <samples_dir> [out_dir] [repeats]" << std::endl;
+        return 1;
+    }
+    std::string samples_dir = argv[1];
+    std::string out_dir = argc > 2 ? argv[2] : std::filesystem::temp_directory_path().string();
+    int repeats = argc > 3 ? std::max(1, std::stoi(argv[3])) : 3;
+
+    std::cout
+        << std::setw(16) << "table"
+        << std::setw(10) << "rows"
+        << std::setw(12) << "xlsx_sec"
+        << std::setw(12) << "csv_sec"
+        << std::setw(14) << "xlsx_rows/s"
+        << std::setw(14) << "csv_rows/s"
+        << std::setw(11) << "speedup"
+        << std::setw(8) << "result"
+        << std::endl;
+
+    bool ok = true;
+    for (std::string suffix : {"_small", ""}) {
+        ok &= Run<Params>("params" + suffix, samples_dir, out_dir, repeats);
+        ok &= Run<Trucks>("trucks" + suffix, samples_dir, out_dir, repeats);
+        ok &= Run<Orders>("orders" + suffix, samples_dir, out_dir, repeats);
+        ok &= Run<Distances>("distances" + suffix, samples_dir, out_dir, repeats);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/*
+    PreSolver on generated per-truck order DAGs
+    Each truck gets edges between random close orders (from < to so graph is acyclic)
+    and some edges from ffo / to flo - variables which arent on some ffo -> flo path are being filtered
+    Also runs one truck with a single path through all orders (deep DAG)
+    Reports best of 'repeats' wall time and count of variables left for 1..'threads' threads
+
+    ./benchmark/presolver_benchmark [trucks] [variables] [orders] [threads] [repeats] [seed]
+*/
+#include "pre_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+    std::vector<variable_t> GenerateVariables(unsigned int seed, size_t trucks_count, size_t variables_count, size_t orders_count) {
+        std::mt19937 rng(seed);
+        std::vector<variable_t> variables;
+        variables.reserve(variables_count);
+
+        // orders truck can reach are close in time - each truck gets its own range of orders
+        size_t per_truck = std::max<size_t>(variables_count / trucks_count, 4);
+        size_t range = std::min<size_t>(orders_count, std::max<size_t>(per_truck / 2, 2));
+        for (size_t truck_pos = 0; truck_pos < trucks_count && variables.size() < variables_count; ++truck_pos) {
+            size_t first_order_pos = rng() % (orders_count - range + 1);
+            for (size_t i = 0; i < per_truck && variables.size() < variables_count; ++i) {
+                size_t kind = rng() % 8;
+                size_t order_pos = first_order_pos + rng() % range;
+                if (kind == 0) {
+                    variables.emplace_back(truck_pos, Solver::ffo_pos, order_pos);
+                } else if (kind == 1) {
+                    variables.emplace_back(truck_pos, order_pos, Solver::flo_pos);
+                } else if (order_pos + 1 < first_order_pos + range) {
+                    size_t to_order_pos = order_pos + 1 + rng() % (first_order_pos + range - order_pos - 1);
+                    variables.emplace_back(truck_pos, order_pos, to_order_pos);
+                }
+            }
+        }
+        return variables;
+    }
+
+    std::vector<variable_t> GeneratePath(size_t orders_count) {
+        std::vector<variable_t> variables;
+        variables.reserve(orders_count + 1);
+        variables.emplace_back(0, Solver::ffo_pos, 0);
+        for (size_t order_pos = 0; order_pos + 1 < orders_count; ++order_pos) {
+            variables.emplace_back(0, order_pos, order_pos + 1);
+        }
+        variables.emplace_back(0, orders_count - 1, Solver::flo_pos);
+        return variables;
+    }
+
+    void Run(const std::string& name, const std::vector<variable_t>& variables, int threads, int repeats) {
+        double best = 1e18;
+        size_t left = 0;
+        for (int it = 0; it < repeats; ++it) {
+            auto start = std::chrono::steady_clock::now();
+            PreSolver pre_solver(variables, threads);
+            left = pre_solver.GetFilteredVariables().size();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::cout << std::fixed << std::setprecision(4)
+            << std::setw(8) << name
+            << std::setw(9) << threads
+            << std::setw(12) << variables.size()
+            << std::setw(12) << left
+            << std::setw(12) << best
+            << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t trucks_count = argc > 1 ? std::stoul(argv[1]) : 2000;
+    size_t variables_count = argc > 2 ? std::stoul(argv[2]) : 100000;
+    size_t orders_count = argc > 3 ? std::stoul(argv[3]) : 5000;
+    int max_threads = argc > 4 ? std::stoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+    int repeats = argc > 5 ? std::stoi(argv[5]) : 3;
+    unsigned int seed = argc > 6 ? std::stoul(argv[6]) : 7;
+
+    std::cout
+        << std::setw(8) << "graph"
+        << std::setw(9) << "threads"
+        << std::setw(12) << "variables"
+        << std::setw(12) << "left"
+        << std::setw(12) << "seconds"
+        << std::endl;
+
+    std::vector<variable_t> variables = GenerateVariables(seed, trucks_count, variables_count, orders_count);
+    for (int threads = 1; threads <= max_threads; ++threads) {
+        Run("random", variables, threads, repeats);
+    }
+    Run("path", GeneratePath(orders_count), 1, repeats);
+    return 0;
+}
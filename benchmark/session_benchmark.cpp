@@ -0,0 +1,241 @@
+/*
+    BatchSolver over a month of daily windows: fresh Highs for every batch against one persistent HighsSession
+    Data is generated (seeded) - cities on a plane, trucks appear during first two days, orders are spread over the month
+    For both models (flow / assignment) and both paths reports:
+    total wall time, HiGHS time (LP + MIP over all batches), reused columns share and revenue of solution
+    Also compares cost of making Data for every window: deep copy (as it was before distances were shared) against batch view
+    'chain-cg' is ChainSolver with column generation (SolverOptions::chain_column_generation)
+    'lagrangian' solves all orders as one window instead: FlowSolver (HiGHS) against LagrangianFlowSolver
+
+    ./benchmark/session_benchmark [chain|chain-cg|flow|all|lagrangian] [trucks] [orders] [days] [seed] [chain_len]
+*/
+#include "batch_solver.h"
+#include "checker.h"
+#include "lagrangian_flow_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+    Data GenerateData(unsigned int seed, size_t cities_count, size_t trucks_count, size_t orders_count, unsigned int days) {
+        std::mt19937 rng(seed);
+
+        Data data;
+        data.params = Params{60., 1., 0.5, 5., 0., 0.};
+
+        // every pair of cities has a road (same as real distances table)
+        Distances& dists = data.GetDistsRef();
+        std::vector<std::pair<double, double>> position(cities_count + 1);
+        for (unsigned int city = 1; city <= cities_count; ++city) {
+            position[city] = {rng() % 500, rng() % 500};
+            data.GetIdToRealCityRef()[city] = city;
+            dists.dists[{city, city}] = 0.;
+        }
+        for (unsigned int from = 1; from <= cities_count; ++from) {
+            for (unsigned int to = 1; to <= cities_count; ++to) {
+                if (from != to) {
+                    double d = std::hypot(position[from].first - position[to].first, position[from].second - position[to].second) + 1;
+                    dists.dists[{from, to}] = d;
+                }
+            }
+        }
+
+        const char* load_types[] = {"Полная", "Задняя", "Боковая, задняя", "Верхняя, задняя"};
+        const char* trailer_types[] = {"Рефрижератор", "Тент"};
+
+        std::vector<Truck> trucks;
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            trucks.emplace_back(truck_pos + 1, load_types[rng() % 4], trailer_types[rng() % 2], rng() % (2*24*60), 1 + rng() % cities_count);
+        }
+        data.trucks = trucks;
+
+        std::vector<Order> orders;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            unsigned int from = 1 + rng() % cities_count;
+            unsigned int to = 1 + rng() % cities_count;
+            if (from == to) {
+                to = 1 + to % cities_count;
+            }
+            double d = dists.dists[{from, to}];
+            unsigned int start_time = rng() % (days*24*60);
+            unsigned int finish_time = start_time + d + rng() % 120;
+            orders.emplace_back(order_pos + 1, false, start_time, finish_time, from, to,
+                load_types[rng() % 4], trailer_types[rng() % 2], d, d * (1.5 + (rng() % 100) / 100.));
+        }
+        data.orders = orders;
+
+        data.cities_count = cities_count;
+        dists.BuildMatrix(cities_count);
+        return data;
+    }
+
+    /*
+        For every window Data of batch is being made 'copies' times (BatchSolver, solver's SetData, FlowSolver::SetData)
+        deep copy clones distances (sparse map + dense matrix) and cities map, batch view only shares them
+    */
+    void RunBatchViews(const Data& data, unsigned int time_window, int copies) {
+        std::vector<Truck> trucks(data.trucks.begin(), data.trucks.end());
+        std::vector<Order> orders(data.orders.begin(), data.orders.end());
+        std::sort(orders.begin(), orders.end(), [](const Order& a, const Order& b) {
+            return a.start_time < b.start_time;
+        });
+
+        double deep_seconds = 0.;
+        double view_seconds = 0.;
+        size_t windows = 0;
+        size_t cloned_dists = 0;
+        auto it = orders.begin();
+        while (it != orders.end()) {
+            unsigned int time_bound = (it->start_time / time_window + 1) * time_window;
+            auto end = std::find_if(it, orders.end(), [time_bound](const Order& order) {
+                return order.start_time >= time_bound;
+            });
+            std::vector<Order> batch_orders(it, end);
+            it = end;
+            ++windows;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int copy = 0; copy < copies; ++copy) {
+                Data batch_data(data);
+                // forcing clone of shared part
+                cloned_dists += batch_data.GetDistsRef().RoadsCount();
+                batch_data.GetIdToRealCityRef();
+                batch_data.trucks = trucks;
+                batch_data.orders = batch_orders;
+            }
+            deep_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            for (int copy = 0; copy < copies; ++copy) {
+                Data batch_data(data, trucks, batch_orders);
+            }
+            view_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::clog << std::fixed << std::setprecision(6)
+            << "batch data: " << windows << " windows x " << copies << " copies, "
+            << "deep copy " << deep_seconds << "s (" << cloned_dists << " distances cloned), "
+            << "batch view " << view_seconds << "s (0 distances cloned), "
+            << std::setprecision(1) << deep_seconds / std::max(view_seconds, 1e-9) << "x"
+            << std::endl;
+    }
+
+    // whole Data as one window (no free-movement edges): same flow model solved by HiGHS and by Lagrangian relaxation
+    void RunWholeWindow(const Data& data) {
+        auto report = [&data](const std::string& name, const solution_t& solution, double seconds, const SolveStats& stats) {
+            Checker checker(data);
+            checker.SetSolution(solution);
+            std::optional<double> revenue = checker.Check();
+            std::clog << std::fixed << std::setprecision(4)
+                << std::setw(12) << name
+                << std::setw(12) << seconds
+                << std::setw(16) << std::setprecision(2) << revenue.value_or(NAN)
+                << std::setw(16) << stats.dual_bound
+                << std::setw(8) << stats.iterations
+                << std::endl;
+        };
+
+        std::clog << std::setw(12) << "solver" << std::setw(12) << "total_sec" << std::setw(16) << "revenue"
+            << std::setw(16) << "dual_bound" << std::setw(8) << "iters" << std::endl;
+
+        {
+            auto start = std::chrono::steady_clock::now();
+            FlowSolver solver;
+            solver.SetData(data);
+            solution_t solution = solver.Solve();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report("highs", solution, seconds, solver.GetLastSolveStats());
+        }
+        {
+            auto start = std::chrono::steady_clock::now();
+            LagrangianFlowSolver solver;
+            solver.SetData(data);
+            solution_t solution = solver.Solve();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report("lagrangian", solution, seconds, solver.GetLastSolveStats());
+        }
+    }
+
+    template<typename T>
+    void Run(const std::string& name, const Data& data, std::shared_ptr<T> solver, bool persistent_session, bool column_generation = false) {
+        SolverOptions options;
+        options.persistent_session = persistent_session;
+        options.chain_column_generation = column_generation;
+        solver->SetOptions(options);
+
+        BatchSolver batch_solver(solver);
+        auto start = std::chrono::steady_clock::now();
+        solution_t solution = batch_solver.Solve(data, 24*60);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double highs_seconds = 0.;
+        size_t kept_columns = 0;
+        size_t columns = 0;
+        for (const SolveStats& stats : batch_solver.GetBatchesStats()) {
+            highs_seconds += stats.lp_time + stats.mip_time;
+            kept_columns += stats.kept_columns;
+            columns += stats.kept_columns + stats.added_columns;
+        }
+
+        Checker checker(data);
+        checker.SetSolution(solution);
+        std::optional<double> revenue = checker.Check();
+
+        std::clog << std::fixed << std::setprecision(4)
+            << std::setw(8) << name
+            << std::setw(10) << (persistent_session ? "session" : "rebuild")
+            << std::setw(9) << batch_solver.GetBatchesStats().size()
+            << std::setw(12) << seconds
+            << std::setw(12) << highs_seconds
+            << std::setw(10) << std::setprecision(1) << (persistent_session ? 100. * kept_columns / std::max<size_t>(columns, 1) : 0.) << "%"
+            << std::setw(16) << std::setprecision(2) << revenue.value_or(NAN)
+            << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    // flow model is much slower - its MIPs take most of the time
+    std::string models = argc > 1 ? argv[1] : "chain";
+    size_t trucks_count = argc > 2 ? std::stoul(argv[2]) : 50;
+    size_t orders_count = argc > 3 ? std::stoul(argv[3]) : 1500;
+    unsigned int days = argc > 4 ? std::stoul(argv[4]) : 30;
+    unsigned int seed = argc > 5 ? std::stoul(argv[5]) : 7;
+    // max count of orders in chain of ChainSolver (both with and without column generation)
+    size_t chain_len = argc > 6 ? std::stoul(argv[6]) : 3;
+
+    Data data = GenerateData(seed, 40, trucks_count, orders_count, days);
+    if (models == "lagrangian") {
+        RunWholeWindow(data);
+        return 0;
+    }
+    RunBatchViews(data, 24*60, 3);
+
+    // solvers are noisy - table goes to std::clog
+    std::clog
+        << std::setw(8) << "model"
+        << std::setw(10) << "path"
+        << std::setw(9) << "batches"
+        << std::setw(12) << "total_sec"
+        << std::setw(12) << "highs_sec"
+        << std::setw(11) << "reused"
+        << std::setw(16) << "revenue"
+        << std::endl;
+
+    for (bool persistent_session : {false, true}) {
+        if (models == "flow" || models == "all") {
+            Run("flow", data, std::make_shared<WeightedCitiesSolver>(), persistent_session);
+        }
+        if (models == "chain" || models == "all") {
+            Run("chain", data, std::make_shared<ChainSolver>(0., chain_len), persistent_session);
+        }
+        if (models == "chain-cg" || models == "all") {
+            Run("chain-cg", data, std::make_shared<ChainSolver>(0., chain_len), persistent_session, true);
+        }
+    }
+    return 0;
+}
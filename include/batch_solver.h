@@ -4,8 +4,6 @@
 #include "weighted_cities_solver.h"
 #include "chain_solver.h"
 
-#include <set>
-
 enum class SOLVER_MODEL_TYPE {
     FLOW_MODEL,
     ASSIGNMENT_MODEL
@@ -15,11 +13,18 @@ class BatchSolver {
 private:
     SOLVER_MODEL_TYPE solver_model_type_;
     std::shared_ptr<Solver> solver_;
+    // SolveStats of every batch of last Solve
+    std::vector<SolveStats> batches_stats_;
 
 public:
     BatchSolver(std::shared_ptr<WeightedCitiesSolver> solver);
     BatchSolver(std::shared_ptr<ChainSolver> solver);
+    /*
+        Solves problem batch by batch with solver options (look SolverOptions::batch_time_budget)
+        Note: status is OPTIMAL only if every batch was solved to optimality
+    */
     solution_t Solve(const Data& data, unsigned int time_window);
+    const std::vector<SolveStats>& GetBatchesStats() const;
 };
 
 #endif // DEFINE_BATCH_SOLVER_H
\ No newline at end of file
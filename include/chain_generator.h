@@ -3,54 +3,163 @@
 
 #include "solver.h"
 
-#include <array>
+#include <cassert>
+#include <cstdint>
 
-#ifdef TEST_BUILD
-constexpr unsigned int MX_LEN = 6;
-#else
-constexpr unsigned int MX_LEN = 3;
-#endif
-
-class Chain {
+// orders of one chain of ChainPool (valid until pool is being changed)
+class ChainView {
 public:
-    static size_t EMPTY_EDGE;
-    std::array<size_t, MX_LEN> chain;
-    double revenue = 0.f;
-    
-    Chain();
-    Chain(const Chain& other);
-    Chain(std::initializer_list<size_t> l);
-
-    void SetRevenue(double revenue);
-    size_t GetEndPos() const;
-    size_t Back() const;
-    size_t operator[](size_t pos) const;
-    size_t& operator[](size_t pos);
+    ChainView(const uint32_t* orders, size_t length, double revenue) : orders_(orders), length_(length), revenue(revenue) {}
+
+    size_t size() const { // NOLINT
+        return length_;
+    }
+    size_t operator[](size_t pos) const {
+        assert(pos < length_);
+        return orders_[pos];
+    }
+    size_t Back() const {
+        assert(length_ > 0);
+        return orders_[length_ - 1];
+    }
+    const uint32_t* begin() const { // NOLINT
+        return orders_;
+    }
+    const uint32_t* end() const { // NOLINT
+        return orders_ + length_;
+    }
 
     #ifdef DEBUG_MODE
     void DebugPrint() const;
     #endif
 private:
-    void Init();
+    const uint32_t* orders_;
+    size_t length_;
+public:
+    double revenue;
 };
 
-class ChainGenerator {
+/*
+    Chains stored in one flat pool: orders of chain 'c' are orders_[offsets_[c], offsets_[c + 1])
+    and its revenue is revenues_[c] - chain of length l takes 4*l + 12 bytes and its length/last order are known in O(1)
+    Note: chains are only being appended (generators rebuild pool if chains have to be changed)
+*/
+class ChainPool {
+public:
+    ChainPool();
+
+    void Clear();
+    // count of chains
+    size_t Size() const;
+    size_t GetOrdersCount() const;
+    size_t GetMemoryBytes() const;
+
+    inline ChainView operator[](size_t chain_pos) const {
+        assert(chain_pos < revenues_.size());
+        return ChainView(orders_.data() + offsets_[chain_pos], offsets_[chain_pos + 1] - offsets_[chain_pos], revenues_[chain_pos]);
+    }
+    inline size_t GetLength(size_t chain_pos) const {
+        return offsets_[chain_pos + 1] - offsets_[chain_pos];
+    }
+    inline size_t Back(size_t chain_pos) const {
+        assert(GetLength(chain_pos) > 0);
+        return orders_[offsets_[chain_pos + 1] - 1];
+    }
+    inline double GetRevenue(size_t chain_pos) const {
+        return revenues_[chain_pos];
+    }
+
+    void Add(const ChainView& chain);
+    void Add(std::initializer_list<size_t> orders, double revenue);
+    void Add(const std::vector<size_t>& orders, double revenue);
+    // copy of chain with 'chain_pos' of this pool plus 'order_pos' in the back
+    void AddExtended(size_t chain_pos, size_t order_pos, double revenue);
+    // same for chain of another pool
+    void AddExtended(const ChainView& chain, size_t order_pos, double revenue);
+
+private:
+    std::vector<uint32_t> orders_;
+    std::vector<uint32_t> offsets_;
+    std::vector<double> revenues_;
+
+    void Close(double revenue);
+};
+
+// chains [first, last) of ChainPool (e.g. chains of one truck - look ChainGenerator::GetTruckChains)
+class ChainsSpan {
 public:
-    std::vector<std::vector<Chain>> chains_by_truck_pos;
+    ChainsSpan(const ChainPool& pool, size_t first, size_t last) : pool_(pool), first_(first), last_(last) {}
+
+    size_t size() const { // NOLINT
+        return last_ - first_;
+    }
+    bool empty() const { // NOLINT
+        return first_ == last_;
+    }
+    ChainView operator[](size_t pos) const {
+        assert(first_ + pos < last_);
+        return pool_[first_ + pos];
+    }
+    // position of first chain in pool
+    size_t GetFirst() const {
+        return first_;
+    }
 
+    class Iterator {
+    public:
+        Iterator(const ChainPool& pool, size_t pos) : pool_(pool), pos_(pos) {}
+        ChainView operator*() const {
+            return pool_[pos_];
+        }
+        Iterator& operator++() {
+            ++pos_;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const {
+            return pos_ != other.pos_;
+        }
+    private:
+        const ChainPool& pool_;
+        size_t pos_;
+    };
+    Iterator begin() const { // NOLINT
+        return Iterator(pool_, first_);
+    }
+    Iterator end() const { // NOLINT
+        return Iterator(pool_, last_);
+    }
+
+private:
+    const ChainPool& pool_;
+    size_t first_;
+    size_t last_;
+};
+
+class ChainGenerator {
+public:
+    // 'mx_chain_len' - max count of orders in chain (any value >= 1)
     ChainGenerator(double min_chain_revenue, size_t mx_chain_len);
 
     void GenerateChains(const Data& data);
+    // chains of at most 'mx_chain_len' orders (e.g. 1 - starting pool of column generation, look ChainSolver)
+    void GenerateChains(const Data& data, size_t mx_chain_len);
     /*
         will generate new orders (free movement edges) and new chains with them so we need non constant reference here
-        Note: 
+        Note:
         (1) cant be called twice for same Data
         (2) there is three possible situation for old chain
             (2.1) stays untouched at same position (there is no free-movement edges for such chain)
             (2.2) can grow but still remains its position (exactly one free-movement edge for such chain)
             (2.3) more than one new chain will be produced based on this chain (multiple free-movement edges)
+        Returns position of free-movement order of every weight in data.orders (weight_pos - position in edges_w_vecs)
     */
-    void AddWeightsEdges(Data& data, const FreeMovementWeightsVectors& edges_w_vecs);
+    std::vector<size_t> AddWeightsEdges(Data& data, const FreeMovementWeightsVectors& edges_w_vecs);
+    // appends new_chains_by_truck_pos[truck_pos] after chains of truck with 'truck_pos' (positions of old chains stay same)
+    void AddChains(const std::vector<ChainPool>& new_chains_by_truck_pos);
+
+    // chains of truck with 'truck_pos' (valid until chains are being changed)
+    ChainsSpan GetTruckChains(size_t truck_pos) const;
+    const ChainPool& GetPool() const;
 
     #ifdef DEBUG_MODE
     void DebugPrint() const;
@@ -60,8 +169,12 @@ private:
     double min_chain_revenue_;
     size_t mx_chain_len_;
 
-    void InitFirstEdge(const Data& data);
-    void Merge(const Data& data, size_t n_times);
+    // chains of all trucks - chains of truck with 'truck_pos' are [truck_chains_[truck_pos], truck_chains_[truck_pos + 1])
+    ChainPool pool_;
+    std::vector<size_t> truck_chains_;
+
+    void InitFirstEdge(const Data& data, size_t truck_pos);
+    void Merge(const Data& data, size_t truck_pos, size_t n_times);
 };
 
 #endif // DEFINE_CHAIN_GENERATOR_H
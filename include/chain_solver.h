@@ -3,6 +3,8 @@
 
 #include "chain_generator.h"
 
+#include <chrono>
+
 
 /*  
     {truck_pos, local_chain_pos} 
@@ -17,13 +19,33 @@ private:
 
     Data data_;
     double min_chain_revenue_;
+    size_t mx_chain_len_;
     ChainGenerator chain_generator;
 
     // index of variable in vector X -> {truck_pos, local_chain_pos}
     std::unordered_map<size_t, chain_variable_t> to_2d_variables;
+    // rows of last CreateModel (-1 if there is no row)
+    std::vector<int> truck_row_;
+    std::vector<int> order_row_;
+
+    // free-movement weights of last SetData and positions of their orders (look ChainGenerator::AddWeightsEdges)
+    FreeMovementWeightsVectors edges_w_vecs_;
+    std::vector<size_t> free_edge_order_pos_;
+
+    /*
+        Column generation (look SolverOptions::chain_column_generation) - instead of all chains up to mx_chain_len
+        only chains which can improve LP relaxation are being added to chains of one order:
+        (1) LP relaxation of model of current chains is being solved (one HighsSession for all rounds - basis is kept)
+        (2) best chain of every truck by reduced revenue is the longest path with duals of rows of orders as penalties
+            (look LongestPathFinder) - chain is being added if its reduced revenue is more than dual of truck row
+        (3) repeat until no chain was added or 'deadline' is reached (every round gets only time left before it)
+        Note: min_chain_revenue filters only starting chains, added chains are limited only by mx_chain_len
+    */
+    void GenerateColumns(std::chrono::steady_clock::time_point deadline);
 
 public:
-    ChainSolver(double min_chain_revenue, size_t mx_chain_len);
+    // Note: mx_chain_len is count of real orders (free-movement edge is being stored as one more order of chain)
+    ChainSolver(double min_chain_revenue, size_t mx_chain_len, const SolverOptions& options = SolverOptions());
 
     void SetData(const Data& data) override;
     
@@ -0,0 +1,86 @@
+#ifndef DEFINE_COMPATIBILITY_INDEX_H
+#define DEFINE_COMPATIBILITY_INDEX_H
+
+#include "main.h"
+#include "xlsx_cell.h"
+#include "trucks.h"
+#include "orders.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+    Precomputed IsExecutableBy for every {truck, order}
+    (1) trucks are grouped into classes by {mask_load_type, mask_trailer_type}
+    (2) orders are grouped into classes by same masks but only by bits which are present in some truck mask
+        - other bits cant affect IsExecutableBy (look its definition)
+        - this way per-truck extra bits of free-movement edges (GetFreeMovementEdges) wont produce new class per truck
+          unless trucks have extra bits too (then its exactly as IsExecutableBy says)
+    (3) IsExecutableBy being called once per {truck class, order class}
+    (4) each truck class stores bitset of executable order positions
+*/
+class CompatibilityIndex {
+public:
+    CompatibilityIndex() = default;
+
+    // true if index was built for exactly same masks of trucks/orders
+    bool IsBuiltFor(const Trucks& trucks, const Orders& orders) const;
+    /*
+        Builds index from scratch
+        Note: if trucks and already indexed orders are same only appended orders are being processed
+        (free-movement edges are being appended to orders)
+    */
+    void Build(const Trucks& trucks, const Orders& orders);
+
+    size_t GetTruckClassesCount() const;
+    size_t GetOrderClassesCount() const;
+    size_t GetTruckClass(size_t truck_pos) const;
+    size_t GetOrderClass(size_t order_pos) const;
+    size_t CountExecutableOrders(size_t truck_pos) const;
+
+    inline bool IsExecutable(size_t truck_pos, size_t order_pos) const {
+        assert(truck_pos < truck_class_.size() && order_pos < order_class_.size());
+        const std::vector<uint64_t>& bitset = orders_bitset_[truck_class_[truck_pos]];
+        return (bitset[order_pos >> 6] >> (order_pos & 63)) & 1;
+    }
+
+    // calls f(order_pos) for every order executable by truck in increasing order of order_pos
+    template<typename F>
+    void ForEachExecutableOrder(size_t truck_pos, F&& f) const {
+        assert(truck_pos < truck_class_.size());
+        const std::vector<uint64_t>& bitset = orders_bitset_[truck_class_[truck_pos]];
+        for (size_t word_pos = 0; word_pos < bitset.size(); ++word_pos) {
+            for (uint64_t word = bitset[word_pos]; word != 0; word &= word - 1) {
+                f((word_pos << 6) + __builtin_ctzll(word));
+            }
+        }
+    }
+
+    #ifdef DEBUG_MODE
+    void DebugPrint() const;
+    #endif
+private:
+    typedef std::pair<int, int> masks_t;
+
+    // OR of masks of all trucks
+    masks_t trucks_bits_ = {0, 0};
+
+    std::vector<masks_t> truck_masks_;
+    std::vector<masks_t> order_masks_;
+
+    std::vector<uint32_t> truck_class_;
+    std::vector<uint32_t> order_class_;
+    std::vector<masks_t> truck_class_masks_;
+    std::vector<masks_t> order_class_masks_;
+
+    // [order_class] -> truck classes which can execute orders of this class
+    std::vector<std::vector<uint32_t>> truck_classes_by_order_class_;
+    // [truck_class] -> bitset over order positions
+    std::vector<std::vector<uint64_t>> orders_bitset_;
+
+    void AddOrders(const Orders& orders, size_t first_order_pos);
+};
+
+#endif // DEFINE_COMPATIBILITY_INDEX_H
@@ -0,0 +1,102 @@
+#ifndef DEFINE_CSV_READER_H
+#define DEFINE_CSV_READER_H
+
+#include "main.h"
+#include "xlsx_cell.h"
+#include "xlsx_stream_reader.h"
+
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+    mktime replacement for parsing a lot of timestamps:
+    utc offset is being computed by mktime once per distinct {local hour, tm_isdst} and cached
+    Note: gives same result as mktime for normalized std::tm (DST transitions happen on hour boundaries)
+*/
+class LocalTimeCache {
+public:
+    time_t MakeTime(const std::tm& t);
+private:
+    std::unordered_map<long long, long long> offsets_;
+};
+
+// same as GetTimeFromSerial/GetTimeFromSerialDays (xlsx_cell.h) but without mktime/gmtime per call
+unsigned int GetTimeFromSerial(double serial, LocalTimeCache& time_cache);
+unsigned int GetTimeFromSerialDays(int serial_days, LocalTimeCache& time_cache);
+
+struct CSVField {
+    // without quotes - they are only escaping (RFC 4180) so quoted field is typed by its content same as unquoted one
+    std::string_view value;
+};
+
+/*
+    Cursor over fields of current row of CSVReader
+    Provides same interface (and same conversions) as XLSXcell/XLSXStreamCell:
+    numbers (quoted or not) are typed by the same rules as numeric xlsx cells (Float if has '.' or "E-", Integer otherwise)
+    Time fields are Excel serial numbers (as in xlsx) or "YYYY-MM-DD[ T]HH:MM[:SS]" / "DD.MM.YYYY[ HH:MM[:SS]]"
+    (the way spreadsheet editors export date cells)
+*/
+class CSVCell {
+private:
+    const std::vector<CSVField>* row_;
+    LocalTimeCache* time_cache_;
+    size_t pos_ = 0;
+
+    const CSVField& field() const;
+public:
+    CSVCell(const std::vector<CSVField>* row, LocalTimeCache* time_cache);
+
+    void next();
+    // true if we moved past last field of the row
+    bool is_end() const;
+
+    XLValueType get_type() const;
+
+    std::optional<unsigned int> get_time_value() const;
+
+    template<typename T>
+    T get_value() const;
+
+    template<typename T>
+    std::optional<T> get_num_value() const;
+};
+
+/*
+    Reads .csv/.tsv row by row (RFC 4180 quoting, "\n" or "\r\n" line endings)
+    File is being mmap-ed, fields are views into it (quoted fields with "" are being unescaped into row storage)
+    Numbers are parsed by std::from_chars (no locale, no allocations)
+*/
+class CSVReader {
+public:
+    using Stats = XLSXStreamReader::Stats;
+
+    /*
+        separator == 0 means auto: '\t' for .tsv,
+        for other files the most frequent of ',' ';' '\t' in the first line
+    */
+    CSVReader(const std::string &path_to_csv, char separator = 0);
+    ~CSVReader();
+
+    // true for .csv/.tsv files (case insensitive)
+    static bool IsCSVPath(const std::string &path);
+
+    // moving to the next row, returns false if there is no more rows
+    bool NextRow();
+    CSVCell FirstCell() const;
+
+    Stats GetStats() const;
+
+    #ifdef DEBUG_MODE
+    void DebugPrintStats(const std::string &name) const;
+    #endif
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // DEFINE_CSV_READER_H
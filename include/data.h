@@ -6,25 +6,47 @@
 #include "trucks.h"
 #include "orders.h"
 #include "distances.h"
+#include "compatibility_index.h"
+#include "successor_index.h"
 
+#include <memory>
 #include <unordered_map>
 
+// wall-clock seconds spent on loading each part of Data
+struct DataLoadTimings {
+    double params = 0.;
+    double trucks = 0.;
+    double orders = 0.;
+    double dists = 0.;
+    // ShiftTimestamps + SqueezeCitiesIds
+    double post_processing = 0.;
+    double total = 0.;
+
+    #ifdef DEBUG_MODE
+    void DebugPrint() const;
+    #endif
+};
+
 class Data {
 public:
     // Note: being initialized in ShiftTimestamps
     unsigned int min_timestamp;
 
     // Note: being initialized in SqueezeCitiesIds
-    std::unordered_map<unsigned int, unsigned int> id_to_real_city;
     size_t cities_count;
 
     Params params;
     Trucks trucks;
     Orders orders;    
-    Distances dists;
+
+    // Note: being initialized only by constructor from files
+    DataLoadTimings load_timings;
 
     Data() = default;
-    // Note: call ShiftTimestamps(), SqueezeCitiesIds()
+    /*
+        Note: files are being parsed concurrently (they are independent until post-processing)
+        then ShiftTimestamps(), SqueezeCitiesIds() being called
+    */
     Data(
         const std::string &params_path,
         const std::string &trucks_path,
@@ -32,6 +54,25 @@ public:
         const std::string &dists_path
     );
     Data(const Data& other);
+    /*
+        Batch of 'other' - shares its distances and cities map (look GetDistsRef) and has only 'trucks' and 'orders'
+        Note: O(trucks + orders) - compatibility/successors indexes are being built for batch from scratch
+    */
+    Data(const Data& other, const std::vector<Truck>& trucks, const std::vector<Order>& orders);
+    Data(Data&& other) = default;
+    Data& operator=(const Data& other) = default;
+    Data& operator=(Data&& other) = default;
+
+    /*
+        Distances and cities map are same for every batch so copies of Data share them
+        Ref-getters clone shared part before giving mutable access to it (copy-on-write)
+        Note: Ref-getters arent thread-safe - they are meant for loading Data (before it is being copied)
+    */
+    const Distances& GetDistsConst() const;
+    Distances& GetDistsRef();
+    // squeezed city id -> city id from files
+    const std::unordered_map<unsigned int, unsigned int>& GetIdToRealCityConst() const;
+    std::unordered_map<unsigned int, unsigned int>& GetIdToRealCityRef();
 
     void ShiftTimestamps();
     void SqueezeCitiesIds();
@@ -46,12 +87,35 @@ public:
     std::optional<double> MoveBetweenOrders(const Order& previous, const Order& current) const;
     
     std::optional<double> CostMovingBetweenOrders(const Order& previous, const Order& current) const;
+    // nullopt if there is no road (look Distances::GetDistance)
+    std::optional<double> GetDistance(unsigned int from_city, unsigned int to_city) const;
+    // time truck arrives after completing 'previous' and driving 'distance' km to next city
+    unsigned int GetArrivingTime(const Order& previous, double distance) const;
     double GetRealOrderRevenue(const Order& order) const;
     double GetRealOrderRevenue(size_t ind) const;
     double GetFreeMovementCost(double distance) const;
     double GetWaitingCost(double mins) const;
 
+    /*
+        Truck/order compatibility (look CompatibilityIndex) - solvers use it instead of IsExecutableBy per pair
+        Note: being (re)built lazily if trucks/orders masks changed since last call (checking it is O(trucks + orders))
+        Note: rebuilding isnt thread-safe - call it once before sharing Data between threads
+    */
+    const CompatibilityIndex& GetCompatibility() const;
+    /*
+        Feasible order-to-order transitions with cached MoveBetweenOrders(previous, current) (look SuccessorIndex)
+        Note: being (re)built lazily if orders/params changed since last call (checking it is O(orders))
+        Note: rebuilding isnt thread-safe - call it once before sharing Data between threads
+        Note: copies of Data share same index until their orders/params are changed
+    */
+    const SuccessorIndex& GetSuccessors() const;
+
 private:
+    std::shared_ptr<Distances> dists_ = std::make_shared<Distances>();
+    std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> id_to_real_city_ = std::make_shared<std::unordered_map<unsigned int, unsigned int>>();
+
+    mutable CompatibilityIndex compatibility_;
+    mutable std::shared_ptr<const SuccessorIndex> successors_;
 };
 
 
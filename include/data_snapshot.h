@@ -0,0 +1,37 @@
+#ifndef DEFINE_DATA_SNAPSHOT_H
+#define DEFINE_DATA_SNAPSHOT_H
+
+#include "data.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+    Binary snapshot of fully built Data (after ShiftTimestamps and SqueezeCitiesIds)
+    Layout (native endianness, every section is 8-byte aligned so file can be used right from mmap):
+    [header][params][trucks records][orders records][distances matrix][distances records][cities records]
+    Dense distances matrix is being used right from the mapping (no parsing or copying - look Distances::SetMatrix),
+    distances records are only roads which dont fit it (all roads in sparse mode - more than MX_DENSE_CITIES cities)
+    Note: trucks, orders, cities map and distances records are being copied into Data containers
+    (plain copy of fixed-size records, still O(trucks + orders + cities + records))
+*/
+class DataSnapshot {
+public:
+    static constexpr uint32_t MAGIC = 0x53414942; // "BIAS"
+    static constexpr uint32_t VERSION = 2;
+
+    /*
+        Fingerprint of input files (their sizes and modification times)
+        snapshot with different fingerprint is considered outdated
+    */
+    static uint64_t Fingerprint(const std::vector<std::string> &paths);
+
+    // false if snapshot wasnt written (previous file at 'path' stays as it was)
+    static bool Write(const Data& data, const std::string &path, uint64_t fingerprint = 0);
+    // std::nullopt if there is no snapshot or its outdated/corrupted (other version, fingerprint etc.)
+    static std::optional<Data> Read(const std::string &path, uint64_t fingerprint = 0);
+};
+
+#endif // DEFINE_DATA_SNAPSHOT_H
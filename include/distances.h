@@ -3,25 +3,100 @@
 
 #include "main.h"
 #include "xlsx_cell.h"
+#include "table_reader.h"
 
 #include <OpenXLSX.hpp>
 
+#include <algorithm>
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 #include <optional>
+#include <cassert>
 
+/*
+    Stores distances between cities in one of two modes (chosen by count of cities):
+    (1) sparse - std::map by {from, to} (being filled by loading, used for more than MX_DENSE_CITIES cities)
+    (2) dense  - row-major (cities_count + 1) x (cities_count + 1) matrix with NO_ROAD sentinel
+    Dense mode being built by BuildMatrix (Data::SqueezeCitiesIds calls it)
+    and expects cities ids to be squeezed (1..cities_count)
+    Note: BuildMatrix moves roads from 'dists' to matrix - map keeps only roads which dont fit it
+    Note: matrix is immutable once built so copies of Distances share it (it can also be mapped from file - look SetMatrix)
+*/
 class Distances {
 public:
-    std::map<std::pair<unsigned int,unsigned int>, double> dists; 
+    // dense matrix wont be built for more cities than that (sparse fallback)
+    static constexpr size_t MX_DENSE_CITIES = 4096;
+    static constexpr double NO_ROAD = -1.;
+
+    std::map<std::pair<unsigned int,unsigned int>, double> dists;
 
     Distances(){};
     Distances(const std::string &path_to_xlsx);
 
+    /*
+        Building dense matrix from 'dists' (if there are not more than MX_DENSE_CITIES cities)
+        Note: roads added to 'dists' after that are being looked for only if they dont fit matrix
+    */
+    void BuildMatrix(size_t cities_count);
+    /*
+        Uses ready matrix of BuildMatrix layout ((cities_count + 1)^2 doubles) without copying it
+        'matrix' keeps its memory alive (e.g. aliasing pointer to mmap of DataSnapshot)
+        'roads_count' - count of roads in it (from != to, look RoadsCount)
+    */
+    void SetMatrix(std::shared_ptr<const double[]> matrix, size_t cities_count, size_t roads_count);
+    // matrix of dense mode (nullptr in sparse mode) - row-major, row size is cities_count + 1
+    const double* GetMatrix() const;
+    bool IsDense() const;
+    // count of roads in both representations (from != to)
+    size_t RoadsCount() const;
+    // calls f(from, to, distance) for every road (from != to) - matrix first then 'dists'
+    template <typename F>
+    void ForEachRoad(F&& f) const;
+
+    // matrix lookup for cities which fit it, 'dists' lookup otherwise
     std::optional<double> GetDistance(unsigned int from, unsigned int to) const;
 
+    /*
+        O(1) lookup without std::optional, returns NO_ROAD if there is no road between cities
+        Note: expects dense mode and cities ids from [0, cities_count]
+    */
+    inline double GetDistanceFast(unsigned int from, unsigned int to) const {
+        assert(IsInMatrix(from, to));
+        return matrix_[from * row_size_ + to];
+    }
+    // both cities have row/column in dense matrix (ids from [0, cities_count])
+    inline bool IsInMatrix(unsigned int from, unsigned int to) const {
+        return std::max(from, to) < row_size_;
+    }
+
     #ifdef DEBUG_MODE
     void DebugPrint();
     #endif
+private:
+    // row-major matrix, 0 row/column is unused because cities ids starts with 1
+    std::shared_ptr<const double[]> matrix_;
+    size_t row_size_ = 0;
+    // roads in matrix (from != to)
+    size_t matrix_roads_count_ = 0;
 };
 
-#endif // DEFINE_DISTANCES_H
\ No newline at end of file
+template <typename F>
+void Distances::ForEachRoad(F&& f) const {
+    for (unsigned int from = 0; from < row_size_; ++from) {
+        for (unsigned int to = 0; to < row_size_; ++to) {
+            double d = matrix_[from * row_size_ + to];
+            if (from != to && d != NO_ROAD) {
+                f(from, to, d);
+            }
+        }
+    }
+    for (const auto& [from_to, d] : dists) {
+        if (from_to.first != from_to.second) {
+            f(from_to.first, from_to.second, d);
+        }
+    }
+}
+
+#endif // DEFINE_DISTANCES_H
@@ -6,6 +6,12 @@
 class FlowSolver : public Solver {
 private:
     Data data_;
+    // trucks of each truck class (look SolverOptions::aggregate_trucks), first one represents class in the model
+    std::vector<std::vector<size_t>> truck_classes_;
+    // truck_pos -> its class
+    std::vector<size_t> class_by_truck_pos_;
+
+    void BuildTruckClasses();
 
 // TO DO: make protected
 public:
@@ -14,7 +20,7 @@ public:
 
 public:
 
-    FlowSolver();
+    explicit FlowSolver(const SolverOptions& options = SolverOptions());
     
     void SetData(const Data& data) override;
     HighsModel CreateModel() override;
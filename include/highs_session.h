@@ -0,0 +1,93 @@
+#ifndef DEFINE_HIGHS_SESSION_H
+#define DEFINE_HIGHS_SESSION_H
+
+#include "Highs.h"
+#include "main.h"
+
+#include <cstdint>
+#include <vector>
+
+// splitmix64 finalizer (bijection)
+inline uint64_t MixKey(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+    Keys of rows/columns are being built by mixing ids of objects they are made of
+    (truck_id, order_id, ...) so same row/column of consecutive models gets same key
+    Note: seed is being mixed before value is added - small ids with different seeds dont collide
+*/
+inline uint64_t CombineKey(uint64_t seed, uint64_t value) {
+    return MixKey(MixKey(seed + 0x9e3779b97f4a7c15ULL) ^ value);
+}
+
+// keys of rows and columns of HighsModel (same positions as in model)
+struct ModelKeys {
+    std::vector<uint64_t> rows;
+    std::vector<uint64_t> cols;
+
+    void Clear();
+};
+
+/*
+    One Highs instance living through many solves (e.g. consecutive batches of BatchSolver)
+    Update passes only difference between previous and new model:
+    (1) rows/columns which keys are gone are being deleted (deleteRows/deleteCols)
+    (2) costs and bounds of kept ones are being changed (changeColsCost/changeColsBounds/changeRowsBounds)
+    (3) new rows and then new columns are being added (addRows/addCols)
+    So HiGHS keeps its basis for kept part of the model (new rows are basic, new columns are nonbasic)
+
+    Note: column key has to define its rows and coefficients completely - matrix of kept columns isnt being checked
+    Note: session positions of rows/columns differ from positions in model (look GetColumnPos)
+*/
+class HighsSession {
+public:
+    HighsSession() = default;
+    HighsSession(const HighsSession& other) = delete;
+    HighsSession& operator=(const HighsSession& other) = delete;
+
+    /*
+        Makes session model equal to 'model' (all columns are continuous after that)
+        Whole model is being passed if keys dont fit the model or some key is not unique (then next Update passes whole model too)
+        or if no column of session model is kept (same as building it again but without stale basis)
+        Note: model has to be stored by columns (look ColumnwiseModelBuilder)
+    */
+    void Update(const HighsModel& model, const ModelKeys& keys);
+
+    Highs& GetHighs();
+    // makes all columns integer (they become continuous again on next Update)
+    void MakeIntegral();
+    // position in session model of column 'col' of last model passed to Update
+    HighsInt GetColumnPos(size_t col) const;
+    // position in session model of row 'row' of last model passed to Update
+    HighsInt GetRowPos(size_t row) const;
+
+    // statistics of last Update
+    bool IsLastUpdateIncremental() const;
+    size_t GetKeptColumnsCount() const;
+    size_t GetAddedColumnsCount() const;
+
+private:
+    Highs highs_;
+    bool is_empty_ = true;
+    bool is_integral_ = false;
+    // keys of session model are known and unique (otherwise next Update passes whole model)
+    bool has_keys_ = false;
+
+    // keys of rows/columns in session order
+    ModelKeys keys_;
+    // model column -> session column
+    std::vector<HighsInt> col_pos_;
+    // model row -> session row
+    std::vector<HighsInt> row_pos_;
+
+    bool last_update_incremental_ = false;
+    size_t kept_cols_count_ = 0;
+    size_t added_cols_count_ = 0;
+
+    void Pass(const HighsModel& model, const ModelKeys& keys, bool has_keys);
+};
+
+#endif // DEFINE_HIGHS_SESSION_H
@@ -0,0 +1,40 @@
+#ifndef DEFINE_LAGRANGIAN_FLOW_SOLVER_H
+#define DEFINE_LAGRANGIAN_FLOW_SOLVER_H
+
+#include "flow_solver.h"
+
+/*
+    Same model as FlowSolver but solved without HiGHS:
+    the only rows shared by trucks are condition 2 (each order is picked at most once / exactly once if obligation)
+    so they are being moved into objective with multipliers (penalties of orders) and model splits by trucks
+    - for every truck its best schedule is the longest path in DAG of orders (look SuccessorIndex)
+
+    (1) paths of trucks are being found by several threads (look SolverOptions::prepare_threads)
+    (2) penalties are being updated by subgradient steps (Polyak step towards best found schedule)
+    (3) every few iterations paths are being repaired into schedule: trucks one by one (best reduced revenue first)
+        take the longest path over orders nobody took yet (obligation orders first)
+    Sum of penalties and paths revenues is upper bound of revenue (dual bound), best repaired schedule is lower one
+    (look SolveStats::primal_bound, SolveStats::dual_bound)
+    Note: status is OPTIMAL if relative gap between bounds is at most SolverOptions::mip_rel_gap,
+    NO_SOLUTION if some obligation order was left in every repaired schedule
+*/
+class LagrangianFlowSolver : public Solver {
+private:
+    Data data_;
+    size_t max_iterations_;
+    // only to give the relaxed model to those who wants it (look CreateModel)
+    FlowSolver flow_solver;
+
+public:
+    explicit LagrangianFlowSolver(size_t max_iterations = 300, const SolverOptions& options = SolverOptions());
+
+    void SetOptions(const SolverOptions& options) override;
+    void SetData(const Data& data) override;
+    const Data& GetDataConst() const override;
+
+    // FlowSolver model of same data (its not being used by Solve)
+    HighsModel CreateModel() override;
+    solution_t Solve() override;
+};
+
+#endif // DEFINE_LAGRANGIAN_FLOW_SOLVER_H
@@ -0,0 +1,56 @@
+#ifndef DEFINE_LONGEST_PATH_FINDER_H
+#define DEFINE_LONGEST_PATH_FINDER_H
+
+#include "data.h"
+
+#include <limits>
+#include <vector>
+
+/*
+    Best schedule of one truck as the longest path from its ffo in DAG of orders (look SuccessorIndex)
+    where revenue of every picked order is decreased by its penalty (duals/multipliers of rows of orders)
+    (1) penalty = FORBIDDEN means order cant be picked
+    (2) path can be ended after any order with additional revenue (end_revenues, look Find)
+    (3) orders are being relaxed by start_time - its topological order of DAG
+        (edges to orders with same or smaller position in SuccessorIndex::GetOrdersByStartTime are skipped
+        - its possible only for zero-length orders with same start_time)
+    (4) max_len > 0 limits count of orders in path - then DP is being made by layers (one for each length)
+    Find is const so several threads can look for paths of different trucks (each with its own Scratch)
+*/
+class LongestPathFinder {
+public:
+    static constexpr double FORBIDDEN = std::numeric_limits<double>::infinity();
+
+    struct Path {
+        // orders in the order of completing
+        std::vector<size_t> orders;
+        // with penalties and end revenue
+        double revenue = 0.;
+    };
+
+    // buffers of one thread (reused by all its calls of Find)
+    struct Scratch {
+        std::vector<double> revenue;
+        std::vector<size_t> parent;
+    };
+
+    // Note: lazy indexes of data are being built here - construct it before threads start
+    explicit LongestPathFinder(const Data& data);
+
+    /*
+        'end_revenues' (if given) are being added to path which ends by order (indexed by order_pos)
+        'empty_revenue' is revenue of path without orders
+    */
+    Path Find(size_t truck_pos, const std::vector<double>& penalties, size_t max_len, Scratch& scratch,
+        const std::vector<double>* end_revenues = nullptr, double empty_revenue = 0.) const;
+
+private:
+    const CompatibilityIndex& compatibility_;
+    const SuccessorIndex& successors_;
+    // position in SuccessorIndex::GetOrdersByStartTime
+    std::vector<uint32_t> rank_;
+    // [truck_pos] -> {order_pos, revenue of moving from ffo and completing order}
+    std::vector<std::vector<std::pair<size_t, double>>> first_orders_;
+};
+
+#endif // DEFINE_LONGEST_PATH_FINDER_H
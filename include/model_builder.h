@@ -0,0 +1,58 @@
+#ifndef DEFINE_MODEL_BUILDER_H
+#define DEFINE_MODEL_BUILDER_H
+
+#include "Highs.h"
+#include "main.h"
+
+#include <cassert>
+#include <vector>
+
+/*
+    Writes HighsModel (c^Tx + d subject to L <= Ax <= U; l <= x <= u) with matrix A stored by columns (CSC)
+    so all arrays are being allocated once and HiGHS doesnt have to transpose matrix
+    (1) AddRow for every row (L, U) - returns its index
+    (2) SetColumnsCount then SetNonZerosCount for every column
+    (3) AllocateNonZeros - start_ is known after that
+    (4) for every column (in increasing order): SetColumn (c, l, u) then AddNonZero for its rows
+    (5) Finish
+    Note: rows of each column have to be added in increasing order (same as HiGHS produces converting rowwise matrix)
+*/
+class ColumnwiseModelBuilder {
+public:
+    ColumnwiseModelBuilder(HighsModel& model, ObjSense sense);
+
+    void ReserveRows(size_t rows_count);
+    int AddRow(double lower, double upper);
+
+    void SetColumnsCount(size_t columns_count);
+    inline void SetNonZerosCount(size_t col, size_t non_zeros_count) {
+        assert(col < columns_count_);
+        start_[col + 1] = non_zeros_count;
+    }
+    void AllocateNonZeros();
+
+    void SetColumn(size_t col, double cost, double lower, double upper);
+    inline void AddNonZero(int row, double value) {
+        assert(cursor_ < static_cast<size_t>(start_[cur_col_ + 1]));
+        assert(row < static_cast<int>(model_.lp_.row_lower_.size()));
+        assert(cursor_ == static_cast<size_t>(start_[cur_col_]) || index_[cursor_ - 1] < row);
+        index_[cursor_] = row;
+        value_[cursor_] = value;
+        ++cursor_;
+    }
+
+    size_t GetNonZerosCount() const;
+    void Finish();
+
+private:
+    HighsModel& model_;
+    std::vector<HighsInt>& start_;
+    std::vector<HighsInt>& index_;
+    std::vector<double>& value_;
+
+    size_t columns_count_ = 0;
+    size_t cur_col_ = 0;
+    size_t cursor_ = 0;
+};
+
+#endif // DEFINE_MODEL_BUILDER_H
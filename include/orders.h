@@ -3,6 +3,7 @@
 
 #include "main.h"
 #include "xlsx_cell.h"
+#include "table_reader.h"
 
 #include <OpenXLSX.hpp>
 
@@ -61,6 +62,9 @@ public:
     Orders(const std::string &path_to_xlsx);
     Orders(const std::vector<Order>& orders);
     Orders(const Orders& other);
+    Orders(Orders&& other) = default;
+    Orders& operator=(const Orders& other) = default;
+    Orders& operator=(Orders&& other) = default;
 
     std::vector<Order>::iterator begin() {  // NOLINT
         return orders_.begin();
@@ -70,6 +74,14 @@ public:
         return orders_.end();
     }
 
+    std::vector<Order>::const_iterator begin() const {  // NOLINT
+        return orders_.begin();
+    }
+
+    std::vector<Order>::const_iterator end() const {  // NOLINT
+        return orders_.end();
+    }
+
     Order GetOrder(size_t ind) const;
     const Order& GetOrderConst(size_t ind) const;
     void AddOrder(const Order& order);
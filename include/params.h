@@ -3,6 +3,7 @@
 
 #include "main.h"
 #include "xlsx_cell.h"
+#include "table_reader.h"
 
 #include <string>
 
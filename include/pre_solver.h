@@ -15,20 +15,37 @@ struct PreSolverNode {
     size_t var_index;
 };
 
+// per-thread memory for reachability of truck sub-graphs
+struct PreSolverScratch {
+    // sub-graph for some truck
+    std::vector<std::vector<PreSolverNode>> graph;
+    std::vector<bool> used;
+    // nodes which were used by sub-graph of current truck
+    std::vector<size_t> graph_nodes;
+    // DFS stack
+    std::vector<size_t> stack;
+};
+
 /* 
     Filtering variables of the model
     Note: variables must form oriented acyclic(not even cycles of length 2 allowed) grapgh
+    Note: trucks are independent so they are being split between 'threads' threads (0 - std::thread::hardware_concurrency())
+    result doesnt depend on count of threads
 */ 
 class PreSolver {
 public:
-    PreSolver(const std::vector<variable_t>& variables);
+    PreSolver(const std::vector<variable_t>& variables, int threads = 1);
     std::vector<variable_t> GetFilteredVariables() const;
 
 private:
     size_t GetGraphNode(size_t order_pos) const;
-    void MarkConnectivityComponent(size_t v);
-    void ClearGraph();
-    void PreSolve();
+    // marks (+1 in valid_vars_) every edge of scratch.graph reachable from 'v' (iterative DFS)
+    void MarkConnectivityComponent(PreSolverScratch& scratch, size_t v);
+    // clears only nodes of last truck sub-graph
+    void ClearGraph(PreSolverScratch& scratch) const;
+    // marks variables of trucks [first_truck_pos, last_truck_pos)
+    void PreSolveTrucks(size_t first_truck_pos, size_t last_truck_pos, PreSolverScratch& scratch);
+    void PreSolve(int threads);
 
     // variable by its index
     std::vector<variable_t> variables_;
@@ -38,11 +55,12 @@ private:
         storing if variable should stay after filtering by its index <=> 2
         because we add +1 in MarkConnectivityComponent(source)
                        +1 time in MarkConnectivityComponent(sink)
+        Note: each variable belongs to one truck so threads write to disjoint elements
     */
     std::vector<int> valid_vars_;
-    // sub-graph for some truck
-    std::vector<std::vector<PreSolverNode>> graph_;
-    std::vector<bool> used_;
+    // indexes of variables of truck with 'truck_pos' are vars_by_truck_[truck_vars_begin_[truck_pos], truck_vars_begin_[truck_pos + 1])
+    std::vector<size_t> truck_vars_begin_;
+    std::vector<size_t> vars_by_truck_;
 };
 
 #endif // DEFINE_PRE_SOLVER_H
\ No newline at end of file
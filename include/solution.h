@@ -3,8 +3,20 @@
 
 #include <vector>
 
+/*
+    OPTIMAL     - proven optimal (up to SolverOptions::mip_rel_gap)
+    INCUMBENT   - some limit was reached, best found solution is returned
+    NO_SOLUTION - limit was reached before any solution was found, no orders are scheduled
+*/
+enum class SOLUTION_STATUS {
+    OPTIMAL,
+    INCUMBENT,
+    NO_SOLUTION
+};
+
 struct solution_t {
     std::vector<std::vector<size_t>> orders_by_truck_pos;
+    SOLUTION_STATUS status = SOLUTION_STATUS::OPTIMAL;
 };
 
 #endif // DEFINE_SOLUTION_H
\ No newline at end of file
@@ -5,7 +5,10 @@
 #include "main.h"
 #include "solution.h"
 #include "data.h"
+#include "model_builder.h"
+#include "highs_session.h"
 
+#include <future>
 #include <unordered_set>
 
 namespace std {
@@ -58,61 +61,185 @@ namespace std {
     };
 }
 
-// weights of cities
-typedef std::map<unsigned int, double> weights_vector_t;
+// one FreeMovementWeightsVectors::AddWeight call - flat form for buffering weights (e.g. by several threads)
+struct FreeMovementWeight {
+    size_t truck_pos;
+    size_t order_pos;
+    unsigned int city_id;
+    double weight;
+};
+
+// positions [first, last) of weights with same {truck_pos, order_pos} (look FreeMovementWeightsVectors::GetWeightByPos)
+struct FreeMovementWeightsRange {
+    size_t first = 0;
+    size_t last = 0;
+
+    bool Empty() const {
+        return first == last;
+    }
+};
+
 /*
     Provides weights for all cities parameterized by {truck_pos, order_pos}
     It says how much weight city will have for truck with 'truck_pos'
     if this truck will go in this city right after making its final order with 'order_pos' 
+
+    Weights are stored as one vector sorted by {truck_pos, order_pos, city_id} (weights of same key are summed)
+    plus ranges of {truck_pos, order_pos} keys grouped by truck
+    Note: added weights are being sorted lazily by first query - it isnt thread-safe (call one before sharing object between threads)
 */
 class FreeMovementWeightsVectors {
 private:
-    std::map<std::pair<size_t, size_t>, weights_vector_t> edges_w_vecs_;
+    mutable std::vector<FreeMovementWeight> weights_;
+    // range of each {truck_pos, order_pos} key, sorted by key
+    mutable std::vector<std::pair<size_t, FreeMovementWeightsRange>> ranges_;
+    // ranges of truck with 'truck_pos' are ranges_[truck_ranges_[truck_pos], truck_ranges_[truck_pos + 1])
+    mutable std::vector<size_t> truck_ranges_;
+    // weights added after last sort
+    mutable size_t unsorted_count_ = 0;
+
+    void Sort() const;
 public:
     FreeMovementWeightsVectors();
     FreeMovementWeightsVectors(const FreeMovementWeightsVectors& other);
     const FreeMovementWeightsVectors& operator=(const FreeMovementWeightsVectors& other);
 
-    std::map<std::pair<size_t, size_t>, weights_vector_t>::const_iterator begin() const {  // NOLINT
-        return edges_w_vecs_.begin();
-    }
-
-    std::map<std::pair<size_t, size_t>, weights_vector_t>::const_iterator end() const {  // NOLINT
-        return edges_w_vecs_.end();
-    }
+    std::vector<FreeMovementWeight>::const_iterator begin() const;  // NOLINT
+    std::vector<FreeMovementWeight>::const_iterator end() const;  // NOLINT
 
     /*
         Generate free-movement orders based on weights vectors
-        Also provides mapping from free-movement edge to its position in orders set:
-        {truck_pos, order_pos, city_id} -> free_movement_order_pos
+        Also provides position of free-movement edge of each weight in generated orders set:
+        free_movement_order_pos[weight_pos] (weight_pos - position in begin()..end())
     */
-    std::pair<Orders, std::unordered_map<std::tuple<size_t, size_t, unsigned int>, size_t>> GetFreeMovementEdges(const Data& data) const;
+    std::pair<Orders, std::vector<size_t>> GetFreeMovementEdges(const Data& data) const;
     
     bool IsInitialized() const;
     std::optional<double> GetWeight(size_t truck_pos, size_t order_pos, unsigned int city_id) const;
-    std::optional<std::reference_wrapper<weights_vector_t>> GetWeightsVector(size_t truck_pos, size_t order_pos);
-    std::optional<std::reference_wrapper<const weights_vector_t>> GetWeightsVectorConst(size_t truck_pos, size_t order_pos) const;
+    // weights of {truck_pos, order_pos} sorted by city_id (empty range if there are none)
+    FreeMovementWeightsRange GetWeightsVectorConst(size_t truck_pos, size_t order_pos) const;
+    const FreeMovementWeight& GetWeightByPos(size_t weight_pos) const;
     void AddWeight(size_t truck_pos, size_t order_pos, unsigned int city_id, double weight);
+    // AddWeight for each of 'weights' in their order
+    void AddWeights(const std::vector<FreeMovementWeight>& weights);
     void Reset();
 };
 
+/*
+    Limits for HiGHS - defaults are HiGHS defaults so solution is proven optimal
+    Note: threads != 0 restarts HiGHS global scheduler if it was initialized with different number of threads
+    (so solvers running at the same time are expected to use same value)
+*/
+struct SolverOptions {
+    // seconds for LP and MIP together
+    double time_limit = kHighsInf;
+    double mip_rel_gap = 1e-4;
+    // 0 - HiGHS chooses by itself
+    int threads = 0;
+    bool presolve = true;
+    // seconds for each batch of BatchSolver (preparing batch + solving it)
+    double batch_time_budget = kHighsInf;
+    // keep one Highs instance between solves and pass only difference of models to it (look HighsSession)
+    bool persistent_session = false;
+    // BatchSolver prepares orders of next batch (and their SuccessorIndex) by another thread while HiGHS solves current one
+    bool pipeline_batches = false;
+    // threads for preparing batch/model before HiGHS gets it (free-movement weights, PreSolver) - 0 means std::thread::hardware_concurrency()
+    int prepare_threads = 0;
+    // FlowSolver makes one commodity with integer supply for trucks with same masks, init_city and init_time
+    bool aggregate_trucks = false;
+    // ChainSolver adds chains by column generation instead of enumerating all of them (look ChainSolver::GenerateColumns)
+    bool chain_column_generation = false;
+};
+
+// which way Solver::Solve got its integral solution and wall-clock seconds spent on each step
+struct SolveStats {
+    // true if LP relaxation was already integral so MIP was skipped
+    bool lp_integral = false;
+    double lp_time = 0.;
+    double mip_time = 0.;
+    SOLUTION_STATUS status = SOLUTION_STATUS::OPTIMAL;
+    // only with SolverOptions::persistent_session - how much of previous model was reused
+    bool incremental = false;
+    size_t kept_columns = 0;
+    size_t added_columns = 0;
+    // only LagrangianFlowSolver - revenue of returned schedule, upper bound of revenue and count of subgradient steps
+    double primal_bound = 0.;
+    double dual_bound = 0.;
+    size_t iterations = 0;
+};
+
+/*
+    Count of threads for 'tasks_count' independent tasks (at least 1 and not more than tasks_count)
+    'threads' - look SolverOptions::prepare_threads (0 means std::thread::hardware_concurrency())
+*/
+size_t ResolveThreadsCount(int threads, size_t tasks_count);
+
+// calls f(thread) for every thread in [0, threads_count) - thread 0 is the calling one, returns after all are done
+template <typename F>
+void ParallelFor(size_t threads_count, F&& f) {
+    std::vector<std::future<void>> workers;
+    for (size_t thread = 1; thread < threads_count; ++thread) {
+        workers.push_back(std::async(std::launch::async, [&f, thread]() { f(thread); }));
+    }
+    f(0);
+    for (auto& worker : workers) {
+        worker.get();
+    }
+}
+
+// tasks are independent - each thread takes every threads_count-th task, calls f(task, thread)
+template <typename F>
+void ParallelForEach(size_t threads_count, size_t tasks_count, F&& f) {
+    ParallelFor(threads_count, [&](size_t thread) {
+        for (size_t task = thread; task < tasks_count; task += threads_count) {
+            f(task, thread);
+        }
+    });
+}
+
 class Solver {
 protected:
+    SolverOptions options_;
+    SolveStats last_solve_stats_;
+
+    // filled by CreateModel only with options_.persistent_session
+    ModelKeys model_keys_;
+    std::unique_ptr<HighsSession> session_;
+
+    /*
+        Solves LP relaxation first and returns its solution if it is already integral
+        otherwise all columns are being made integer and MIP is being solved by same Highs instance
+        (LP solution is given to it as starting point - HiGHS uses it only if its feasible)
+        If options_.time_limit is reached best incumbent is returned (look last_solve_stats_.status)
+        Note: returns columns with value 1
+    */
     std::vector<size_t> Solve(HighsModel& model);
+    // options_ (time limit, gap, threads, presolve) for Highs which is run by solver itself
+    static void ApplyOptions(Highs& highs, const SolverOptions& options);
 
 public:
-    Solver() = default;
+    explicit Solver(const SolverOptions& options = SolverOptions());
 
     static size_t ffo_pos;
     static size_t flo_pos;
     static std::function<Order(const Truck&)> make_ffo;
     static std::function<Order(const Order&)> make_flo;
     static bool IsFakeOrder(size_t order_pos);
+    /*
+        Same order gets same key in every batch (used for keys of rows/columns - look HighsSession)
+        free-movement orders dont have ids so they are identified by {from_city, to_city, start_time}
+    */
+    static uint64_t GetOrderKey(const Order& order);
+    static uint64_t GetFakeOrderKey(size_t order_pos);
     
     virtual void SetData(const Data& data) = 0;
     virtual HighsModel CreateModel() = 0;
     virtual solution_t Solve() = 0;
     virtual const Data& GetDataConst() const = 0;
+
+    virtual void SetOptions(const SolverOptions& options);
+    const SolverOptions& GetOptions() const;
+    const SolveStats& GetLastSolveStats() const;
 };
 
 #endif // DEFINE_SOLVER_H
@@ -0,0 +1,83 @@
+#ifndef DEFINE_SUCCESSOR_INDEX_H
+#define DEFINE_SUCCESSOR_INDEX_H
+
+#include "main.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class Data;
+
+/*
+    Graph of feasible order-to-order transitions (Data::MoveBetweenOrders(previous, current) has value)
+    stored as CSR: successors of order 'p' are targets_[offsets_[p]..offsets_[p+1]) with cached revenue
+    (revenue is exactly MoveBetweenOrders(previous, current) - moving/waiting cost + real revenue of current)
+
+    Built by sorting orders by start_time and binary searching the earliest possible successor
+    (current.start_time >= previous.finish_time is necessary since distances are non-negative)
+    then only suffix of orders sorted by start_time is being walked - orders which start before previous one finishes
+    are never being checked (build is O(sum of candidates) MoveBetweenOrders calls, not O(orders^2))
+    Note: successors of each order are sorted by position (each row is being sorted once after walking its suffix)
+    Note: masks are not checked here (look CompatibilityIndex)
+    Note: waiting is always allowed so edges count grows quadratically with time horizon of orders
+    - index is meant for batches (solvers Data), not for whole month of orders
+*/
+class SuccessorIndex {
+public:
+    SuccessorIndex() = default;
+
+    // true if index was built for same orders/params/distances (look Fingerprint)
+    bool IsBuiltFor(const Data& data) const;
+    /*
+        Builds index from scratch
+        Note: if 'previous' was built for prefix of orders (free-movement edges are being appended to orders)
+        its edges are being reused and only edges to/from appended orders are being checked
+    */
+    void Build(const Data& data, const SuccessorIndex* previous = nullptr);
+
+    size_t GetOrdersCount() const;
+    size_t GetEdgesCount() const;
+    size_t GetDegree(size_t order_pos) const;
+
+    // calls f(to_order_pos, revenue) for every successor in increasing order of to_order_pos
+    template<typename F>
+    void ForEachSuccessor(size_t order_pos, F&& f) const {
+        assert(order_pos + 1 < offsets_.size());
+        for (size_t edge = offsets_[order_pos]; edge < offsets_[order_pos + 1]; ++edge) {
+            f(static_cast<size_t>(targets_[edge]), revenues_[edge]);
+        }
+    }
+
+    // positions of orders sorted by {start_time, position}
+    const std::vector<uint32_t>& GetOrdersByStartTime() const;
+
+    /*
+        Hash of everything index depends on: first 'orders_count' orders times/cities/distance/revenue, params, distances
+        Note: distances are being taken in account only by size and mode (dense/sparse)
+        - they are not supposed to be changed after loading
+    */
+    static uint64_t Fingerprint(const Data& data, size_t orders_count);
+
+    #ifdef DEBUG_MODE
+    void DebugPrint() const;
+    #endif
+private:
+    uint64_t fingerprint_ = 0;
+    bool built_ = false;
+
+    std::vector<size_t> offsets_;
+    std::vector<uint32_t> targets_;
+    std::vector<double> revenues_;
+
+    std::vector<uint32_t> by_start_time_;
+
+    /*
+        Appends feasible successors of order with position >= first_to_order_pos (in increasing order of position)
+        'row' - buffer for successors before sorting (reused between rows)
+    */
+    void AddSuccessors(const Data& data, size_t from_order_pos, size_t first_to_order_pos, const std::vector<unsigned int>& start_times, std::vector<std::pair<uint32_t, double>>& row);
+};
+
+#endif // DEFINE_SUCCESSOR_INDEX_H
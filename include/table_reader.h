@@ -0,0 +1,59 @@
+#ifndef DEFINE_TABLE_READER_H
+#define DEFINE_TABLE_READER_H
+
+#include "main.h"
+#include "xlsx_cell.h"
+#include "xlsx_stream_reader.h"
+#include "csv_reader.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+
+// cell of TableReader - XLSXStreamCell or CSVCell (same interface)
+class TableCell {
+private:
+    std::variant<XLSXStreamCell, CSVCell> cell_;
+public:
+    TableCell(const XLSXStreamCell& cell);
+    TableCell(const CSVCell& cell);
+
+    void next();
+    bool is_end() const;
+
+    XLValueType get_type() const;
+
+    std::optional<unsigned int> get_time_value() const;
+
+    template<typename T>
+    T get_value() const;
+
+    template<typename T>
+    std::optional<T> get_num_value() const;
+};
+
+/*
+    Reads input table by format of the file:
+    CSVReader for .csv/.tsv, XLSXStreamReader ("Sheet1") otherwise
+    so Params/Trucks/Orders/Distances are being parsed by the same code (=> same Data) for every format
+*/
+class TableReader {
+public:
+    using Stats = XLSXStreamReader::Stats;
+
+    TableReader(const std::string &path);
+
+    bool NextRow();
+    TableCell FirstCell() const;
+
+    Stats GetStats() const;
+
+    #ifdef DEBUG_MODE
+    void DebugPrintStats(const std::string &name) const;
+    #endif
+private:
+    std::variant<std::unique_ptr<XLSXStreamReader>, std::unique_ptr<CSVReader>> reader_;
+};
+
+#endif // DEFINE_TABLE_READER_H
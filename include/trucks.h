@@ -3,6 +3,7 @@
 
 #include "main.h"
 #include "xlsx_cell.h"
+#include "table_reader.h"
 
 #include <OpenXLSX.hpp>
 
@@ -38,6 +39,9 @@ public:
     Trucks(const std::string &path_to_xlsx);
     Trucks(const std::vector<Truck>& trucks);
     Trucks(const Trucks& other);
+    Trucks(Trucks&& other) = default;
+    Trucks& operator=(const Trucks& other) = default;
+    Trucks& operator=(Trucks&& other) = default;
 
     std::vector<Truck>::iterator begin() { // NOLINT
         return trucks_.begin();
@@ -47,6 +51,14 @@ public:
         return trucks_.end();
     }
 
+    std::vector<Truck>::const_iterator begin() const { // NOLINT
+        return trucks_.begin();
+    }
+
+    std::vector<Truck>::const_iterator end() const { // NOLINT
+        return trucks_.end();
+    }
+
     Truck GetTruck(size_t ind) const;
     const Truck& GetTruckConst(size_t ind) const;
     Truck& GetTruckRef(size_t ind);
@@ -32,7 +32,10 @@ private:
     // Adding new free-movement edges according to FreeMovementWeightsVectors
     void ModifyData(Data& data) const;
 public:
-    WeightedCitiesSolver();
+    explicit WeightedCitiesSolver(const SolverOptions& options = SolverOptions());
+
+    // options are being passed to inner FlowSolver (it solves the model)
+    void SetOptions(const SolverOptions& options) override;
     
     const Data& GetDataConst() const override;
 
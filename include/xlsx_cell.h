@@ -47,6 +47,10 @@ bool IsExecutableBy(
     int truck_mask_trailer_type, 
     int order_mask_load_type, 
     int order_mask_trailer_type);
+// minutes since UNIX epoch by Excel date/time serial number (as it being stored in Float cells)
+unsigned int GetTimeFromSerial(double serial);
+// same as above for Integer cells (whole days)
+unsigned int GetTimeFromSerialDays(int serial_days);
 
 class XLSXcell {
 private:
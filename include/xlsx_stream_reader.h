@@ -0,0 +1,82 @@
+#ifndef DEFINE_XLSX_STREAM_READER_H
+#define DEFINE_XLSX_STREAM_READER_H
+
+#include "main.h"
+#include "xlsx_cell.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// raw cell of the sheet (value is being converted only on demand)
+struct XLSXStreamValue {
+    XLValueType type = XLValueType::Empty;
+    // number/shared string index/inline string as it is stored in sheet XML
+    std::string raw;
+};
+
+/*
+    Cursor over cells of current row of XLSXStreamReader
+    Provides same interface (and same conversions) as XLSXcell so rows can be parsed in the same way
+*/
+class XLSXStreamCell {
+private:
+    const std::vector<XLSXStreamValue>* row_;
+    const std::vector<std::string>* shared_strings_;
+    size_t pos_ = 0;
+
+    const XLSXStreamValue& value() const;
+public:
+    XLSXStreamCell(const std::vector<XLSXStreamValue>* row, const std::vector<std::string>* shared_strings);
+
+    void next();
+    // true if we moved past last cell of the row
+    bool is_end() const;
+
+    XLValueType get_type() const;
+
+    std::optional<unsigned int> get_time_value() const;
+
+    template<typename T>
+    T get_value() const;
+
+    template<typename T>
+    std::optional<T> get_num_value() const;
+};
+
+/*
+    Reads worksheet of .xlsx row by row without building DOM of the sheet
+    (sheet XML is being inflated and tokenized by fixed-size chunks => memory doesnt depend on sheet size
+    except shared strings table which is being stored as it is)
+    Note: missing rows are reported as empty ones (same as OpenXLSX does)
+*/
+class XLSXStreamReader {
+public:
+    struct Stats {
+        size_t rows = 0;
+        double seconds = 0.;
+        // peak resident set size of the whole process
+        long peak_rss_kb = 0;
+
+        double GetRowsPerSecond() const;
+    };
+
+    XLSXStreamReader(const std::string &path_to_xlsx, const std::string &sheet_name = "Sheet1");
+    ~XLSXStreamReader();
+
+    // moving to the next row, returns false if there is no more rows
+    bool NextRow();
+    XLSXStreamCell FirstCell() const;
+
+    Stats GetStats() const;
+
+    #ifdef DEBUG_MODE
+    void DebugPrintStats(const std::string &name) const;
+    #endif
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // DEFINE_XLSX_STREAM_READER_H
@@ -1,5 +1,12 @@
 #include "batch_solver.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
 
 BatchSolver::BatchSolver(std::shared_ptr<WeightedCitiesSolver> solver) : solver_(std::move(solver)) {
     solver_model_type_ = SOLVER_MODEL_TYPE::FLOW_MODEL;
@@ -9,39 +16,189 @@ BatchSolver::BatchSolver(std::shared_ptr<ChainSolver> solver) : solver_(std::mov
     solver_model_type_ = SOLVER_MODEL_TYPE::ASSIGNMENT_MODEL;
 }
 
-template <class T>
-struct cmp {
-    bool operator() (const std::pair<unsigned int, T>& a, const std::pair<unsigned int, T>& b) const {
-        return a.first < b.first;
+const std::vector<SolveStats>& BatchSolver::GetBatchesStats() const {
+    return batches_stats_;
+}
+
+/*
+    Orders of main Data sorted by start_time once (stable - same start_time keeps order of main Data)
+    Orders before 'cursor' are released - taken to some batch or dropped by FilterSuffix
+*/
+struct OrderQueue {
+    const Orders& orders;
+    std::vector<size_t> order_pos_by_start_time;
+    size_t cursor = 0;
+
+    explicit OrderQueue(const Orders& orders) : orders(orders), order_pos_by_start_time(orders.Size()) {
+        std::iota(order_pos_by_start_time.begin(), order_pos_by_start_time.end(), 0);
+        std::stable_sort(order_pos_by_start_time.begin(), order_pos_by_start_time.end(), [&orders](size_t a, size_t b) {
+            return orders.GetOrderConst(a).start_time < orders.GetOrderConst(b).start_time;
+        });
+    }
+
+    bool Empty() const {
+        return cursor == order_pos_by_start_time.size();
+    }
+
+    size_t Size() const {
+        return order_pos_by_start_time.size() - cursor;
+    }
+
+    const Order& Get(size_t ind) const {
+        return orders.GetOrderConst(order_pos_by_start_time[ind]);
     }
 };
 
-template <class T>
-void GetBatch(
-    std::vector<T>& batch,
-    unsigned int time_bound,
-    std::multiset<std::pair<unsigned int, T>, cmp<T>>& obj_by_init_time
-) {
-    while(!obj_by_init_time.empty()) {
-        auto it = obj_by_init_time.begin();
-
-        // checking if our object 'belongs' to current time window 
-        unsigned int time = it->first;
-        if (time < time_bound) {
-            batch.emplace_back(std::move(it->second));
-            obj_by_init_time.erase(it);
-        } else {
-            break;
+/*
+    Trucks waiting for batch - min-heap of {init_time, insertion number, truck position in main Data}
+    Insertion number keeps trucks with same init_time in order they were pushed
+*/
+struct TruckQueue {
+    using Entry = std::tuple<unsigned int, size_t, size_t>;
+
+    // current state of every truck of main Data (init_time/init_city change after each batch)
+    std::vector<Truck> trucks;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    size_t pushed = 0;
+
+    explicit TruckQueue(const Trucks& trucks) : trucks(trucks.begin(), trucks.end()) {
+        for (size_t truck_pos = 0; truck_pos < this->trucks.size(); ++truck_pos) {
+            Push(truck_pos);
         }
     }
+
+    void Push(size_t truck_pos) {
+        heap.emplace(trucks[truck_pos].init_time, pushed++, truck_pos);
+    }
+};
+
+static void GetBatch(std::vector<Truck>& batch, unsigned int time_bound, TruckQueue& trucks_by_init_time) {
+    auto& heap = trucks_by_init_time.heap;
+    // checking if our truck 'belongs' to current time window
+    while (!heap.empty() && std::get<0>(heap.top()) < time_bound) {
+        batch.push_back(trucks_by_init_time.trucks[std::get<2>(heap.top())]);
+        heap.pop();
+    }
 }
 
+/*
+    Copies orders starting from 'ind' while they start before time_bound
+    Returns index of first order which wasnt copied
+*/
+static size_t CollectOrders(const OrderQueue& order_by_start_time, size_t ind, unsigned int time_bound, std::vector<Order>& orders) {
+    for (; ind < order_by_start_time.order_pos_by_start_time.size() && order_by_start_time.Get(ind).start_time < time_bound; ++ind) {
+        orders.push_back(order_by_start_time.Get(ind));
+    }
+    return ind;
+}
+
+static void GetBatch(std::vector<Order>& batch, unsigned int time_bound, OrderQueue& order_by_start_time) {
+    order_by_start_time.cursor = CollectOrders(order_by_start_time, order_by_start_time.cursor, time_bound, batch);
+}
+
+/*
+    Orders of next batch bucketed by from_city, each bucket is sorted by start_time
+    For every source city (where truck is after its last order) buckets it has road to are being listed once
+    with distance to them, sorted by start_time of their last order (latest first)
+    so for some last order only reachable cities which still have orders after it finishes are being visited
+    (without looking for distances) and only orders truck can get to in time are being scanned
+*/
+class FutureOrdersIndex {
+public:
+    /*
+        'sources' - cities ForEachReachable is going to be called from (to_city of last orders, init_city of trucks)
+        Note: O(sources * cities of next batch) distances lookups split between threads (look SolverOptions::prepare_threads)
+    */
+    FutureOrdersIndex(const Data& data, const std::vector<Order>& future_orders, std::vector<unsigned int> sources, int threads)
+        : orders_(future_orders), sources_(std::move(sources)) {
+        std::stable_sort(orders_.begin(), orders_.end(), [](const Order& a, const Order& b) {
+            return std::tie(a.from_city, a.start_time) < std::tie(b.from_city, b.start_time);
+        });
+        for (size_t pos = 0; pos < orders_.size(); ++pos) {
+            if (buckets_.empty() || buckets_.back().city != orders_[pos].from_city) {
+                buckets_.push_back(Bucket{orders_[pos].from_city, pos, pos});
+            }
+            ++buckets_.back().end;
+        }
+
+        std::vector<size_t> by_last_start(buckets_.size());
+        std::iota(by_last_start.begin(), by_last_start.end(), 0);
+        std::stable_sort(by_last_start.begin(), by_last_start.end(), [this](size_t a, size_t b) {
+            return GetLastStartTime(buckets_[a]) > GetLastStartTime(buckets_[b]);
+        });
+
+        std::sort(sources_.begin(), sources_.end());
+        sources_.erase(std::unique(sources_.begin(), sources_.end()), sources_.end());
+        roads_.resize(sources_.size());
+        ParallelForEach(ResolveThreadsCount(threads, sources_.size()), sources_.size(), [&](size_t source_pos, size_t) {
+            for (size_t bucket_pos : by_last_start) {
+                if (auto d = data.GetDistance(sources_[source_pos], buckets_[bucket_pos].city)) {
+                    roads_[source_pos].push_back(Road{bucket_pos, d.value()});
+                }
+            }
+        });
+    }
+
+    /*
+        Calls f(order) for every order of next batch which starts after truck could arrive to its from_city
+        Note: last_order.to_city has to be one of sources
+    */
+    template <class F>
+    void ForEachReachable(const Data& data, const Order& last_order, F&& f) const {
+        auto source = std::lower_bound(sources_.begin(), sources_.end(), last_order.to_city);
+        assert(source != sources_.end() && *source == last_order.to_city);
+        for (const Road& road : roads_[source - sources_.begin()]) {
+            const Bucket& bucket = buckets_[road.bucket_pos];
+            // even without driving truck wont make it to last order of this bucket (and of every bucket after it)
+            if (GetLastStartTime(bucket) < last_order.finish_time) {
+                break;
+            }
+            unsigned int arriving_time = data.GetArrivingTime(last_order, road.distance);
+
+            auto end = orders_.begin() + bucket.end;
+            auto it = std::lower_bound(orders_.begin() + bucket.begin, end, arriving_time, [](const Order& order, unsigned int time) {
+                return order.start_time < time;
+            });
+            for (; it != end; ++it) {
+                f(*it);
+            }
+        }
+    }
+
+private:
+    struct Bucket {
+        unsigned int city;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Road {
+        size_t bucket_pos;
+        double distance;
+    };
+
+    std::vector<Order> orders_;
+    std::vector<Bucket> buckets_;
+    // sorted cities and roads from each of them (sorted by GetLastStartTime of bucket, latest first)
+    std::vector<unsigned int> sources_;
+    std::vector<std::vector<Road>> roads_;
+
+    unsigned int GetLastStartTime(const Bucket& bucket) const {
+        return orders_[bucket.end - 1].start_time;
+    }
+};
+
+/*
+    'future_orders' are orders of next batch (sorted by start_time)
+    Trucks are being split between 'threads' threads (look SolverOptions::prepare_threads)
+    each of them buffers its weights, buffers are being merged in trucks order so result doesnt depend on 'threads'
+*/
 static void UpdateFreeMovementWeightsVectors(
     FreeMovementWeightsVectors& edges_w_vecs,
     const Data& batch_data,
     unsigned int time_bound,
-    unsigned int time_window,
-    const std::multiset<std::pair<unsigned int, Order>, cmp<Order>>& suf_orders
+    const std::vector<Order>& future_orders,
+    int threads
 ) {
     static constexpr double eps = 1e-6;
 
@@ -51,10 +208,9 @@ static void UpdateFreeMovementWeightsVectors(
     const Orders& batch_orders = batch_data.orders;
 
     const size_t batch_trucks_count = batch_trucks.Size();
-    const size_t batch_orders_count = batch_orders.Size();
 
     static auto update_edges_w_vecs = [](
-        FreeMovementWeightsVectors& edges_w_vecs,
+        std::vector<FreeMovementWeight>& weights,
         const Data& batch_data,
         const Truck& truck,
         const Order& from_order,
@@ -71,7 +227,7 @@ static void UpdateFreeMovementWeightsVectors(
                 bonus = std::max(bonus, 2*eps);
             }
             if (bonus >= eps) {
-                edges_w_vecs.AddWeight(truck_pos, order_pos, to_city, bonus);
+                weights.push_back(FreeMovementWeight{truck_pos, order_pos, to_city, bonus});
             }
         }
     };
@@ -88,79 +244,102 @@ static void UpdateFreeMovementWeightsVectors(
         (1) because each truck has its own last order by same reasons and we will add edges for this order
         (2) we will add multiple edges for some cities which is init_city for more than one truck
     */
-    for (size_t truck_pos = 0; truck_pos < batch_trucks_count; ++truck_pos) {
-        const Truck& truck = batch_trucks.GetTruckConst(truck_pos);
-
-        for (size_t order_pos = 0; order_pos < batch_orders_count; ++order_pos) {
-            const Order& last_order = batch_orders.GetOrderConst(order_pos);
-
-            // there is no point in free-movement edges when last order finishes after next batch will start
-            if (last_order.finish_time >= time_bound) {
-                continue;
-            } else if (!IsExecutableBy(
-                truck.mask_load_type, 
-                truck.mask_trailer_type, 
-                last_order.mask_load_type, 
-                last_order.mask_trailer_type)
-            ) { // bad trailer or load type
-                continue;
-            } else if (truck.init_city != last_order.from_city && truck.init_time >= last_order.start_time) {
-                // not compulsory check because solvers simply wont use such edges - made for performance
-                continue;
-            }
-
-            for (const auto& [_, future_order] : suf_orders) {
-                /*
-                    we need only orders that belong to next batch
-                    Note: working fast because we are using break here(orders are sorted by start_time)
-                */
-                if (future_order.start_time >= time_bound + time_window) {
-                    break;
+    // built before threads start (it is lazy and isnt thread-safe)
+    const CompatibilityIndex& compatibility = batch_data.GetCompatibility();
+
+    // last orders of trucks end in to_city of some batch order or in init_city of truck (ffo)
+    std::vector<unsigned int> sources;
+    sources.reserve(batch_orders.Size() + batch_trucks_count);
+    for (const Order& order : batch_orders) {
+        sources.push_back(order.to_city);
+    }
+    for (const Truck& truck : batch_trucks) {
+        sources.push_back(Solver::make_ffo(truck).to_city);
+    }
+    const FutureOrdersIndex future_index(batch_data, future_orders, std::move(sources), threads);
+
+    auto process_trucks = [&](size_t first_truck_pos, size_t last_truck_pos, std::vector<FreeMovementWeight>& weights) {
+        for (size_t truck_pos = first_truck_pos; truck_pos < last_truck_pos; ++truck_pos) {
+            const Truck& truck = batch_trucks.GetTruckConst(truck_pos);
+
+            // only orders executable by truck (bad trailer or load type otherwise)
+            compatibility.ForEachExecutableOrder(truck_pos, [&](size_t order_pos) {
+                const Order& last_order = batch_orders.GetOrderConst(order_pos);
+
+                // there is no point in free-movement edges when last order finishes after next batch will start
+                if (last_order.finish_time >= time_bound) {
+                    return;
+                } else if (truck.init_city != last_order.from_city && truck.init_time >= last_order.start_time) {
+                    // not compulsory check because solvers simply wont use such edges - made for performance
+                    return;
                 }
-                update_edges_w_vecs(edges_w_vecs, batch_data, truck, last_order, future_order, truck_pos, order_pos);
-            }
-        }
 
-        for (const auto& [_, future_order] : suf_orders) {
-            /*
-                we need only orders that belong to next batch
-                Note: working fast because we are using break here(orders are sorted by start_time)
-            */
-            if (future_order.start_time >= time_bound + time_window) {
-                break;
-            }
+                future_index.ForEachReachable(batch_data, last_order, [&](const Order& future_order) {
+                    update_edges_w_vecs(weights, batch_data, truck, last_order, future_order, truck_pos, order_pos);
+                });
+            });
+
             // processing our last order is ffo <=> we wont make any orders on current batch at all
-            {
-                const Order& ffo = Solver::make_ffo(truck);
-                update_edges_w_vecs(edges_w_vecs, batch_data, truck, ffo, future_order, truck_pos, Solver::ffo_pos);
-            }
+            const Order& ffo = Solver::make_ffo(truck);
+            future_index.ForEachReachable(batch_data, ffo, [&](const Order& future_order) {
+                update_edges_w_vecs(weights, batch_data, truck, ffo, future_order, truck_pos, Solver::ffo_pos);
+            });
         }
+    };
+
+    size_t threads_count = ResolveThreadsCount(threads, batch_trucks_count);
+
+    std::vector<std::vector<FreeMovementWeight>> weights(threads_count);
+    ParallelFor(threads_count, [&](size_t thread) {
+        process_trucks(batch_trucks_count * thread / threads_count, batch_trucks_count * (thread + 1) / threads_count, weights[thread]);
+    });
+
+    for (const auto& thread_weights : weights) {
+        edges_w_vecs.AddWeights(thread_weights);
     }
 }
 
-static void FilterSuffix(
-    std::multiset<std::pair<unsigned int, Truck>, cmp<Truck>>& trucks_by_init_time,
-    std::multiset<std::pair<unsigned int, Order>, cmp<Order>>& order_by_start_time
-) {
-    assert(!trucks_by_init_time.empty());
+static void FilterSuffix(TruckQueue& trucks_by_init_time, OrderQueue& order_by_start_time) {
+    assert(!trucks_by_init_time.heap.empty());
 
-    unsigned int min_init_time = trucks_by_init_time.begin()->first;
-    while (!order_by_start_time.empty()) {
-        auto it = order_by_start_time.begin();
-        if (it->first < min_init_time) {
-            order_by_start_time.erase(it);
-        } else {
-            break;
-        }
+    unsigned int min_init_time = std::get<0>(trucks_by_init_time.heap.top());
+    while (!order_by_start_time.Empty() && order_by_start_time.Get(order_by_start_time.cursor).start_time < min_init_time) {
+        ++order_by_start_time.cursor;
     }
 }
 
+/*
+    Part of next batch which doesnt depend on solution of current one (look SolverOptions::pipeline_batches)
+    Note: FilterSuffix can drop first orders after solution is known - prefetched orders are being checked before use
+*/
+struct BatchPrefetch {
+    unsigned int time_bound;
+    // batch of main Data with orders (as if no orders were filtered) and built SuccessorIndex
+    Data data;
+    // orders of batch after it
+    std::vector<Order> future_orders;
+};
+
+static BatchPrefetch PrefetchBatch(
+    const Data& data,
+    const OrderQueue& order_by_start_time,
+    unsigned int time_bound,
+    unsigned int time_window
+) {
+    std::vector<Order> batch_orders;
+    std::vector<Order> future_orders;
+    size_t ind = CollectOrders(order_by_start_time, order_by_start_time.cursor, time_bound, batch_orders);
+    CollectOrders(order_by_start_time, ind, time_bound + time_window, future_orders);
+
+    BatchPrefetch prefetch{time_bound, Data(data, {}, batch_orders), std::move(future_orders)};
+    prefetch.data.GetSuccessors();
+    return prefetch;
+}
+
 solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
     // main Data
-    Params params = data.params;
     Trucks trucks = data.trucks;
-    Orders orders = data.orders;
-    Distances dists = data.dists;
+    const Orders& orders = data.orders;
 
     size_t trucks_count = trucks.Size();
     size_t orders_count = orders.Size();
@@ -181,14 +360,8 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
     }
 
     // Avaible trucks and orders
-    std::multiset<std::pair<unsigned int, Truck>, cmp<Truck>> trucks_by_init_time;
-    for (const Truck& truck : trucks) {
-        trucks_by_init_time.emplace(truck.init_time, truck);
-    }
-    std::multiset<std::pair<unsigned int, Order>, cmp<Order>> order_by_start_time;
-    for (const Order& order : orders) {
-        order_by_start_time.emplace(order.start_time, order);
-    }
+    TruckQueue trucks_by_init_time(trucks);
+    OrderQueue order_by_start_time(orders);
     // Making sure we dont have useless orders
     FilterSuffix(trucks_by_init_time, order_by_start_time);
 
@@ -196,28 +369,63 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
     std::vector<Truck> batch_trucks;
     std::vector<Order> batch_orders;
 
+    /*
+        Solver options are being restored after solving
+        Note: each batch gets SolverOptions::batch_time_budget seconds - HiGHS gets what is left of it after batch was prepared
+    */
+    const SolverOptions options = solver_->GetOptions();
+    batches_stats_.clear();
+
+    /*
+        Next batch is being prefetched by another thread while HiGHS solves current one
+        Note: order_by_start_time isnt being changed until prefetch is done
+    */
+    std::future<BatchPrefetch> prefetch_future;
+    std::optional<BatchPrefetch> prefetch;
+
     FreeMovementWeightsVectors edges_w_vecs;
     for(unsigned int cur_time_window = time_window;; cur_time_window += time_window) {
         // check if we processed all orders
-        if (order_by_start_time.empty()) {
+        if (order_by_start_time.Empty()) {
             break;
         }
 
         // Adding trucks/orders to current batches
-        GetBatch<Truck>(batch_trucks, cur_time_window, trucks_by_init_time);
-        GetBatch<Order>(batch_orders, cur_time_window, order_by_start_time);
+        GetBatch(batch_trucks, cur_time_window, trucks_by_init_time);
+        GetBatch(batch_orders, cur_time_window, order_by_start_time);
+
+        // prefetch is made only for batch right after solved one
+        if (prefetch && prefetch->time_bound != cur_time_window) {
+            prefetch.reset();
+        }
 
         // we suppose to double our time segment and try grow batches  
         if (batch_trucks.empty() || batch_orders.empty()) {
             continue;
         }
         // batches is okay here so we should sovle sub-problem on them and realese later 
+        auto batch_start = std::chrono::steady_clock::now();
 
-        // Initializing data for sub-problem
-        Data batch_data(data);
+        // Initializing data for sub-problem (SuccessorIndex of prefetch is being kept only if orders are same)
+        Data batch_data = (prefetch ? std::move(prefetch->data) : Data(data, {}, {}));
         batch_data.trucks = batch_trucks;
         batch_data.orders = batch_orders;
 
+        // orders of next batch
+        std::vector<Order> future_orders;
+        if (prefetch) {
+            // FilterSuffix could drop some first orders - they start before first one which is left
+            unsigned int min_start_time = (order_by_start_time.Empty() ? UINT32_MAX : order_by_start_time.Get(order_by_start_time.cursor).start_time);
+            for (const Order& order : prefetch->future_orders) {
+                if (order.start_time >= min_start_time) {
+                    future_orders.push_back(order);
+                }
+            }
+            prefetch.reset();
+        } else {
+            CollectOrders(order_by_start_time, order_by_start_time.cursor, cur_time_window + time_window, future_orders);
+        }
+
         /*
             Same additional bits will be used later in LOAD_TYPE of free-movement edges of this truck 
             this will block other trucks from picking this edges => reduce amount of variables in LP model
@@ -227,7 +435,7 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
             truck.mask_load_type += batch_truck_pos * (1 << LOAD_TYPE_COUNT);
         }
 
-        std::cout << "Complete around ~" << (orders_count - order_by_start_time.size()) * 100 / orders_count << std::endl;
+        std::cout << "Complete around ~" << (orders_count - order_by_start_time.Size()) * 100 / orders_count << std::endl;
         std::cout << "BATCH_DEBUG: " << batch_data.trucks.Size() << " " << batch_data.orders.Size() << std::endl;
 
         #ifdef DEBUG_MODE
@@ -238,7 +446,9 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
         #endif   
         
         // Solving problem with current batches
-        UpdateFreeMovementWeightsVectors(edges_w_vecs, batch_data, cur_time_window, time_window, order_by_start_time);
+        UpdateFreeMovementWeightsVectors(edges_w_vecs, batch_data, cur_time_window, future_orders, options.prepare_threads);
+        // built once per batch - solvers share it through copies of batch_data (and only extend it with free-movement orders)
+        batch_data.GetSuccessors();
         
         // not necessary now but can have some hard unique logic for solver
         switch (solver_model_type_) {
@@ -257,7 +467,27 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
             }
         }
 
+        {
+            double spent = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+            SolverOptions batch_options = options;
+            batch_options.time_limit = std::min(options.time_limit, std::max(0., options.batch_time_budget - spent));
+            solver_->SetOptions(batch_options);
+        }
+        if (options.pipeline_batches) {
+            prefetch_future = std::async(std::launch::async, PrefetchBatch,
+                std::cref(data), std::cref(order_by_start_time), cur_time_window + time_window, time_window);
+        }
         solution_t batch_solution = solver_->Solve();
+        solver_->SetOptions(options);
+        if (prefetch_future.valid()) {
+            prefetch = prefetch_future.get();
+        }
+        batches_stats_.push_back(solver_->GetLastSolveStats());
+
+        // batch without solution leaves its trucks idle - whole solution is still feasible but not optimal
+        if (batch_solution.status != SOLUTION_STATUS::OPTIMAL) {
+            main_solution.status = SOLUTION_STATUS::INCUMBENT;
+        }
 
         // We want to work with free-movement orders (read Note in weighted_cities_solver.h / chain_solver.h)
         const Data& modified_batch_data = solver_->GetDataConst();
@@ -299,7 +529,9 @@ solution_t BatchSolver::Solve(const Data& data, unsigned int time_window) {
                 cur_truck.init_city = order.to_city;
             }
 
-            trucks_by_init_time.emplace(cur_truck.init_time, std::move(cur_truck));
+            size_t real_truck_pos = truck_pos_by_id[cur_truck.truck_id];
+            trucks_by_init_time.trucks[real_truck_pos] = std::move(cur_truck);
+            trucks_by_init_time.Push(real_truck_pos);
         }
 
         // Releasing old batches
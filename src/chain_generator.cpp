@@ -1,70 +1,84 @@
 #include "chain_generator.h"
 
-///////////
-// CHAIN //
-///////////
+#include <algorithm>
+#include <limits>
+
+////////////////
+// CHAIN POOL //
+////////////////
 
 #ifdef DEBUG_MODE
 using std::cout;
 using std::endl;
-void Chain::DebugPrint() const {
+void ChainView::DebugPrint() const {
     std::cout << "  chain: ";
-    for (size_t i = 0; i < GetEndPos(); ++i) {
-        std::cout << chain[i] << ' ';
+    for (size_t order_pos : *this) {
+        std::cout << order_pos << ' ';
     }
     std::cout << '\n';
 }
 #endif
 
-size_t Chain::EMPTY_EDGE = static_cast<size_t>(-1);
+ChainPool::ChainPool() : offsets_{0} {}
 
-void Chain::Init() {
-    chain.fill(Chain::EMPTY_EDGE);
+void ChainPool::Clear() {
+    orders_.clear();
+    offsets_.assign(1, 0);
+    revenues_.clear();
 }
 
-Chain::Chain() {
-    Init();
+size_t ChainPool::Size() const {
+    return revenues_.size();
 }
 
-Chain::Chain(const Chain& other) {
-    revenue = other.revenue;
-    chain = other.chain;
+size_t ChainPool::GetOrdersCount() const {
+    return orders_.size();
 }
 
-Chain::Chain(std::initializer_list<size_t> l) {
-    size_t cur = 0;
-    for (size_t order_pos : l) {
-        chain[cur++] = order_pos;
-    }
-    for (; cur < MX_LEN; ++cur) {
-        chain[cur] = Chain::EMPTY_EDGE;
-    }
+size_t ChainPool::GetMemoryBytes() const {
+    return orders_.capacity() * sizeof(uint32_t) + offsets_.capacity() * sizeof(uint32_t) + revenues_.capacity() * sizeof(double);
 }
 
-size_t Chain::GetEndPos() const {
-    for(size_t i = 0; i < MX_LEN; ++i) {
-        if (chain[i] == Chain::EMPTY_EDGE) {
-            return i;
-        }
-    }
-    return MX_LEN;
+void ChainPool::Close(double revenue) {
+    assert(orders_.size() <= std::numeric_limits<uint32_t>::max());
+    offsets_.push_back(static_cast<uint32_t>(orders_.size()));
+    revenues_.push_back(revenue);
 }
 
-size_t Chain::Back() const {
-    return chain[GetEndPos() - 1];
+void ChainPool::Add(const ChainView& chain) {
+    orders_.insert(orders_.end(), chain.begin(), chain.end());
+    Close(chain.revenue);
 }
 
-size_t Chain::operator[](size_t pos) const {
-    return chain[pos];
+void ChainPool::Add(std::initializer_list<size_t> orders, double revenue) {
+    for (size_t order_pos : orders) {
+        orders_.push_back(static_cast<uint32_t>(order_pos));
+    }
+    Close(revenue);
 }
 
-size_t& Chain::operator[](size_t pos) {
-    return chain[pos];
+void ChainPool::Add(const std::vector<size_t>& orders, double revenue) {
+    for (size_t order_pos : orders) {
+        orders_.push_back(static_cast<uint32_t>(order_pos));
+    }
+    Close(revenue);
 }
 
+void ChainPool::AddExtended(size_t chain_pos, size_t order_pos, double revenue) {
+    // chain is being copied by positions - orders_ can be reallocated by resize
+    size_t first = offsets_[chain_pos];
+    size_t length = offsets_[chain_pos + 1] - first;
+    size_t dest = orders_.size();
+    orders_.resize(dest + length + 1);
+    std::copy_n(orders_.begin() + first, length, orders_.begin() + dest);
+    orders_.back() = static_cast<uint32_t>(order_pos);
+    Close(revenue);
+}
 
-void Chain::SetRevenue(double _revenue) {
-    revenue = _revenue;
+void ChainPool::AddExtended(const ChainView& chain, size_t order_pos, double revenue) {
+    orders_.insert(orders_.end(), chain.begin(), chain.end());
+    orders_.push_back(static_cast<uint32_t>(order_pos));
+    Close(revenue);
 }
 
 /////////////////////
@@ -72,13 +86,10 @@ void Chain::SetRevenue(double _revenue) {
 /////////////////////
 
 #ifdef DEBUG_MODE
-using std::cout;
-using std::endl;
 void ChainGenerator::DebugPrint() const {
-    size_t truck_pos = 0;
-    for (const auto& chains : chains_by_truck_pos) {
+    for (size_t truck_pos = 0; truck_pos + 1 < truck_chains_.size(); ++truck_pos) {
         std::cout << "truck " << truck_pos << '\n';
-        for (const Chain& chain : chains) {
+        for (ChainView chain : GetTruckChains(truck_pos)) {
             chain.DebugPrint();
         }
     }
@@ -87,139 +98,109 @@ void ChainGenerator::DebugPrint() const {
 
 ChainGenerator::ChainGenerator(double min_chain_revenue, size_t mx_chain_len) :
     min_chain_revenue_(min_chain_revenue),
-    mx_chain_len_(mx_chain_len)
+    mx_chain_len_(mx_chain_len),
+    truck_chains_{0}
 {
     assert(mx_chain_len_ >= 1);
 }
 
-void ChainGenerator::GenerateChains(const Data& data) {
-    ADD_WEIGHTS_EDGES_CALL_COUNT = 0;
-
-    const Trucks& trucks = data.trucks;
-
-    size_t trucks_count = trucks.Size();
-    chains_by_truck_pos.clear();
-    chains_by_truck_pos.resize(trucks_count);
+ChainsSpan ChainGenerator::GetTruckChains(size_t truck_pos) const {
+    assert(truck_pos + 1 < truck_chains_.size());
+    return ChainsSpan(pool_, truck_chains_[truck_pos], truck_chains_[truck_pos + 1]);
+}
 
-    InitFirstEdge(data);
+const ChainPool& ChainGenerator::GetPool() const {
+    return pool_;
+}
 
-    if (mx_chain_len_ > 1) {
-        Merge(data, mx_chain_len_ - 1);
-    }
+void ChainGenerator::GenerateChains(const Data& data) {
+    GenerateChains(data, mx_chain_len_);
 }
 
-void ChainGenerator::InitFirstEdge(const Data& data) {
-    const Trucks& trucks = data.trucks;
-    const Orders& orders = data.orders;
+void ChainGenerator::GenerateChains(const Data& data, size_t mx_chain_len) {
+    assert(mx_chain_len >= 1);
+    ADD_WEIGHTS_EDGES_CALL_COUNT = 0;
 
-    const size_t trucks_count = trucks.Size();
-    const size_t orders_count = orders.Size();
+    const size_t trucks_count = data.trucks.Size();
+    pool_.Clear();
+    truck_chains_.assign(1, 0);
 
+    // chains of every truck are being generated one after another - so they take contiguous part of pool
     for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const Truck& truck = trucks.GetTruckConst(truck_pos);
-
-        // our fake first order (state after completing it <=> initial state of truck)
-        Order from_order = Solver::make_ffo(truck);
+        InitFirstEdge(data, truck_pos);
+        if (mx_chain_len > 1) {
+            Merge(data, truck_pos, mx_chain_len - 1);
+        }
+        truck_chains_.push_back(pool_.Size());
+    }
+}
 
-        for (size_t to_order_pos = 0; to_order_pos < orders_count; ++to_order_pos) {
-            const Order& to_order = orders.GetOrderConst(to_order_pos);
+void ChainGenerator::InitFirstEdge(const Data& data, size_t truck_pos) {
+    const Orders& orders = data.orders;
+    const CompatibilityIndex& compatibility = data.GetCompatibility();
 
-            auto raw_cost = data.MoveBetweenOrders(truck, from_order, to_order);
-            if (!raw_cost.has_value()) {
-                continue;
-            }
-            double cost = raw_cost.value();
+    // our fake first order (state after completing it <=> initial state of truck)
+    Order from_order = Solver::make_ffo(data.trucks.GetTruckConst(truck_pos));
 
-            if (!to_order.obligation && cost - min_chain_revenue_ < 0) {
-                continue;
-            }
+    // only orders executable by truck
+    compatibility.ForEachExecutableOrder(truck_pos, [&](size_t to_order_pos) {
+        const Order& to_order = orders.GetOrderConst(to_order_pos);
 
-            Chain chain{to_order_pos};
-            chain.SetRevenue(cost);
+        auto raw_cost = data.MoveBetweenOrders(from_order, to_order);
+        if (!raw_cost.has_value()) {
+            return;
+        }
+        double cost = raw_cost.value();
 
-            chains_by_truck_pos[truck_pos].push_back(std::move(chain));
+        if (!to_order.obligation && cost - min_chain_revenue_ < 0) {
+            return;
         }
-    }
+
+        pool_.Add({to_order_pos}, cost);
+    });
 }
 
-void ChainGenerator::Merge(const Data& data, size_t n_times) {
-    const Trucks& trucks = data.trucks;
+void ChainGenerator::Merge(const Data& data, size_t truck_pos, size_t n_times) {
     const Orders& orders = data.orders;
 
-    const size_t trucks_count = trucks.Size();
-    const size_t orders_count = orders.Size();
-
     // stores for each order_pos all orders that can go after (also stores revenue addition)
-    std::vector<std::vector<std::pair<size_t, double>>> compatible_orders(orders_count);
-    for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
-        const Order& from_order = orders.GetOrderConst(from_order_pos);
-
-        for (size_t to_order_pos = 0; to_order_pos < orders_count; ++to_order_pos) {
-            const Order& to_order = orders.GetOrderConst(to_order_pos);
-
-            auto raw_revenue_addition = data.MoveBetweenOrders(from_order, to_order);
-            if (!raw_revenue_addition.has_value()) {
-                continue;
-            }
-            double revenue_addition = raw_revenue_addition.value();
-            compatible_orders[from_order_pos].push_back({to_order_pos, revenue_addition});
-        }
-    }
+    const SuccessorIndex& successors = data.GetSuccessors();
+    const CompatibilityIndex& compatibility = data.GetCompatibility();
+
+    // int i-th merge we suppose to use chains that was produced on (i-1)-th merge
+    size_t old_size = truck_chains_.back();
+
+    // merging each chain n times
+    for (size_t i = 0; i < n_times; ++i) {
+        size_t cur_size = pool_.Size();
+
+        // choosing chain to merge with (by position - pool grows inside the loop)
+        for (size_t chain_pos = old_size; chain_pos < cur_size; ++chain_pos) {
+            size_t last_order_pos = pool_.Back(chain_pos);
+            double chain_revenue = pool_.GetRevenue(chain_pos);
+
+            // choosing order to merge chain with
+            successors.ForEachSuccessor(last_order_pos, [&](size_t to_order_pos, double revenue_bonus) {
+                if (!compatibility.IsExecutable(truck_pos, to_order_pos)) {
+                    // bad trailer or load type
+                    return;
+                }
+                const Order& to_order = orders.GetOrderConst(to_order_pos);
 
-    // choosing truck
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const Truck& truck = trucks.GetTruckConst(truck_pos);
-
-        // int i-th merge we suppose to use chains that was produced on (i-1)-th merge
-        size_t old_size = 0;
-        
-        // merging each chain n times
-        for (unsigned int i = 0; i < n_times; ++i) {
-            size_t cur_size = chains_by_truck_pos[truck_pos].size();
-
-            // choosing chain to merge with
-            for (size_t chain_pos = old_size; chain_pos < cur_size; ++chain_pos) {
-                // we cant use const reference here because reallocations
-                Chain chain = chains_by_truck_pos[truck_pos][chain_pos];
-                size_t end_pos = chain.GetEndPos();
-                assert(end_pos > 0);
-                
-                size_t last_order_pos = chain[end_pos - 1];
-                const Order& from_order = orders.GetOrderConst(last_order_pos);
-
-                // choosing order to merge chain with
-                for (auto [to_order_pos, revenue_bonus] : compatible_orders[last_order_pos]) {
-                    const Order& to_order = orders.GetOrderConst(to_order_pos);
-
-                    if (!IsExecutableBy(
-                        truck.mask_load_type, 
-                        truck.mask_trailer_type, 
-                        to_order.mask_load_type, 
-                        to_order.mask_trailer_type)
-                    ) {  // bad trailer or load type
-                        continue;
-                    }
-                    double revenue = chain.revenue;
-                    revenue += revenue_bonus;
-
-                    if (!to_order.obligation && revenue - min_chain_revenue_ < 0) {
-                        continue;
-                    }
-
-                    Chain new_chain(chain);
-                    new_chain[end_pos] = to_order_pos;
-                    new_chain.SetRevenue(revenue);
-
-                    chains_by_truck_pos[truck_pos].push_back(std::move(new_chain));
+                double revenue = chain_revenue + revenue_bonus;
+                if (!to_order.obligation && revenue - min_chain_revenue_ < 0) {
+                    return;
                 }
-            }
 
-            old_size = cur_size;
+                pool_.AddExtended(chain_pos, to_order_pos, revenue);
+            });
         }
+
+        old_size = cur_size;
     }
 }
 
-void ChainGenerator::AddWeightsEdges(Data& data, const FreeMovementWeightsVectors& edges_w_vecs) {
+std::vector<size_t> ChainGenerator::AddWeightsEdges(Data& data, const FreeMovementWeightsVectors& edges_w_vecs) {
     assert(ADD_WEIGHTS_EDGES_CALL_COUNT == 0);
     ADD_WEIGHTS_EDGES_CALL_COUNT++;
 
@@ -231,70 +212,73 @@ void ChainGenerator::AddWeightsEdges(Data& data, const FreeMovementWeightsVector
     for (const Order& order : additional_orders) {
         data.orders.AddOrder(order);
     }
+    for (size_t& order_pos : free_edge_to_pos) {
+        order_pos += main_orders_count;
+    }
+
+    // chains are growing - pool is being rebuilt (chains of every truck are still contiguous)
+    ChainPool pool;
+    std::vector<size_t> truck_chains(1, 0);
 
     for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+        ChainsSpan chains = GetTruckChains(truck_pos);
+
         /*
-            We want to look at all chains of some truck and add new ones to same set of chains
-            we will store count of old chains to iterate only over old ones
+            we want to take current chain and produce |S| new chains
+            where S is set of free-movement edges of its last order
+            current chain is being extended by first free-movement edge (so it keeps its position)
+            and (|S| - 1) new chains are being added after all old chains
         */
-        size_t old_chains_count = chains_by_truck_pos[truck_pos].size();
-        for (size_t chain_pos = 0; chain_pos < old_chains_count; ++chain_pos) {
-            // must make copy here - read logic below
-            Chain chain = chains_by_truck_pos[truck_pos][chain_pos];
-
-            size_t end_pos = chain.GetEndPos();
-            assert(end_pos > 0);
-            size_t last_order_pos = chain[end_pos - 1];
-
-            auto raw_vec = edges_w_vecs.GetWeightsVectorConst(truck_pos, last_order_pos);
-            if (!raw_vec.has_value()) {
+        for (ChainView chain : chains) {
+            FreeMovementWeightsRange range = edges_w_vecs.GetWeightsVectorConst(truck_pos, chain.Back());
+            if (range.Empty()) {
+                pool.Add(chain);
                 continue;
             }
-            const weights_vector_t& vec = raw_vec.value();
-
-            /*
-                we want to take current chain and produce |S| new chains 
-                where S is set of free-movement edges called 'vec' below
-                in order to make it faster lets just change current chain for first free-movement edge
-                and add (|S| - 1) new chains
-            */
-            bool first = true;
-            for(const auto& [to_city, revenue_bonus] : vec) {
-                size_t free_edge_pos = free_edge_to_pos[{truck_pos, last_order_pos, to_city}];
-                free_edge_pos += main_orders_count;
-
-                if (first) {
-                    Chain& old_chain = chains_by_truck_pos[truck_pos][chain_pos];
-                    old_chain.chain[end_pos] = free_edge_pos;
-                    old_chain.revenue += revenue_bonus;
-                    first = false;
-                } else {
-                    Chain new_chain(chain);
-                    new_chain[end_pos] = free_edge_pos;
-                    new_chain.revenue += revenue_bonus;
-
-                    chains_by_truck_pos[truck_pos].push_back(std::move(new_chain));
-                }
+            double revenue_bonus = edges_w_vecs.GetWeightByPos(range.first).weight;
+            pool.AddExtended(chain, free_edge_to_pos[range.first], chain.revenue + revenue_bonus);
+        }
+        for (ChainView chain : chains) {
+            FreeMovementWeightsRange range = edges_w_vecs.GetWeightsVectorConst(truck_pos, chain.Back());
+            for (size_t weight_pos = range.first + 1; weight_pos < range.last; ++weight_pos) {
+                double revenue_bonus = edges_w_vecs.GetWeightByPos(weight_pos).weight;
+                pool.AddExtended(chain, free_edge_to_pos[weight_pos], chain.revenue + revenue_bonus);
             }
         }
 
         // lets also take in account free-movement edges from ffo or case where truck wont pick any orders
-        {
-            auto raw_vec = edges_w_vecs.GetWeightsVectorConst(truck_pos, Solver::ffo_pos);
-            if (!raw_vec.has_value()) {
-                continue;
-            }
-            const weights_vector_t& vec = raw_vec.value();
+        FreeMovementWeightsRange range = edges_w_vecs.GetWeightsVectorConst(truck_pos, Solver::ffo_pos);
+        for (size_t weight_pos = range.first; weight_pos < range.last; ++weight_pos) {
+            double revenue_bonus = edges_w_vecs.GetWeightByPos(weight_pos).weight;
+            pool.Add({free_edge_to_pos[weight_pos]}, revenue_bonus);
+        }
 
-            for(const auto& [to_city, revenue_bonus] : vec) {
-                size_t free_edge_pos = free_edge_to_pos[{truck_pos, Solver::ffo_pos, to_city}];
-                free_edge_pos += main_orders_count;
+        truck_chains.push_back(pool.Size());
+    }
 
-                Chain new_chain({free_edge_pos});
-                new_chain.revenue += revenue_bonus;
+    pool_ = std::move(pool);
+    truck_chains_ = std::move(truck_chains);
 
-                chains_by_truck_pos[truck_pos].push_back(std::move(new_chain));
-            }
-        }   
+    return free_edge_to_pos;
+}
+
+void ChainGenerator::AddChains(const std::vector<ChainPool>& new_chains_by_truck_pos) {
+    const size_t trucks_count = truck_chains_.size() - 1;
+    assert(new_chains_by_truck_pos.size() == trucks_count);
+
+    ChainPool pool;
+    std::vector<size_t> truck_chains(1, 0);
+    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+        for (ChainView chain : GetTruckChains(truck_pos)) {
+            pool.Add(chain);
+        }
+        const ChainPool& new_chains = new_chains_by_truck_pos[truck_pos];
+        for (size_t chain_pos = 0; chain_pos < new_chains.Size(); ++chain_pos) {
+            pool.Add(new_chains[chain_pos]);
+        }
+        truck_chains.push_back(pool.Size());
     }
-}
\ No newline at end of file
+
+    pool_ = std::move(pool);
+    truck_chains_ = std::move(truck_chains);
+}
@@ -1,7 +1,12 @@
 #include "chain_solver.h"
+#include "longest_path_finder.h"
 
-ChainSolver::ChainSolver(double min_chain_revenue, size_t mx_chain_len) :
+#include <algorithm>
+
+ChainSolver::ChainSolver(double min_chain_revenue, size_t mx_chain_len, const SolverOptions& options) :
+    Solver(options),
     min_chain_revenue_(min_chain_revenue),
+    mx_chain_len_(mx_chain_len),
     chain_generator(min_chain_revenue_, mx_chain_len)
 {};
 
@@ -14,30 +19,33 @@ void ChainSolver::SetData(const Data& data) {
     data_ = data;
     to_2d_variables = {};
     real_orders_count = data_.orders.Size();
-    chain_generator.GenerateChains(data_);
+    edges_w_vecs_.Reset();
+    free_edge_order_pos_.clear();
+    if (options_.chain_column_generation) {
+        // starting pool - longer chains are being added by GenerateColumns
+        chain_generator.GenerateChains(data_, 1);
+    } else {
+        chain_generator.GenerateChains(data_);
+    }
 }
 
 void ChainSolver::SetData(const Data& data, const FreeMovementWeightsVectors& edges_w_vecs) {
     SetData(data);
-    chain_generator.AddWeightsEdges(data_, edges_w_vecs);
+    free_edge_order_pos_ = chain_generator.AddWeightsEdges(data_, edges_w_vecs);
+    edges_w_vecs_ = edges_w_vecs;
 }
 
 HighsModel ChainSolver::CreateModel() {
-    Trucks trucks = data_.trucks;
-    Orders orders = data_.orders;
+    const Trucks& trucks = data_.trucks;
+    const Orders& orders = data_.orders;
 
     size_t trucks_count = trucks.Size();
     size_t orders_count = orders.Size();
 
-    const std::vector<std::vector<Chain>>& chains_by_truck_pos = chain_generator.chains_by_truck_pos;
-
     // c^Tx + d subject to L <= Ax <= U; l <= x <= u
     HighsModel model;
-    // maximizing revenue => kMaximize
-    model.lp_.sense_ = ObjSense::kMaximize;
-    // writing matrix A by rows
-    model.lp_.a_matrix_.format_ = MatrixFormat::kRowwise;
-    model.lp_.offset_ = 0;
+    // maximizing revenue => kMaximize, writing matrix A by columns
+    ColumnwiseModelBuilder builder(model, ObjSense::kMaximize);
 
 
     #ifdef DEBUG_MODE
@@ -53,72 +61,38 @@ HighsModel ChainSolver::CreateModel() {
         lets calculate l,u for l <= x <= u
         for every (i,c) -> i-th truck will pick c-th chain in its set of chains
     */
-    std::unordered_map<std::tuple<size_t, size_t>, size_t> to_index;
     size_t cur_var_id = 0;
     for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const auto& chains = chains_by_truck_pos[truck_pos];
-        const size_t chains_count = chains.size();
-        
-        for (size_t chain_pos = 0; chain_pos < chains_count; ++chain_pos) {
-            to_2d_variables[cur_var_id] = chain_variable_t{truck_pos, chain_pos};
-            to_index[{truck_pos, chain_pos}] = cur_var_id++;
+        const size_t chains_count = chain_generator.GetTruckChains(truck_pos).size();
 
-            model.lp_.col_lower_.push_back(0);
-            model.lp_.col_upper_.push_back(1);
+        for (size_t chain_pos = 0; chain_pos < chains_count; ++chain_pos) {
+            to_2d_variables[cur_var_id++] = chain_variable_t{truck_pos, chain_pos};
         }
     }
 
 
-    // setting number of rows in l,u,x (number of variables)
-    model.lp_.num_col_ = to_2d_variables.size();
-
-
-    // processing c
-    // model.lp_.col_cost_
-    model.lp_.col_cost_.resize(model.lp_.num_col_);
-    for (auto &el : to_2d_variables) {
-        size_t ind = el.first;
-        const auto& [truck_pos, chain_pos] = el.second;
-        
-        double c = chains_by_truck_pos[truck_pos][chain_pos].revenue;
-        model.lp_.col_cost_[ind] = c;
-    }
-
-
     // A
     // L, U
     // model.lp_.a_matrix_.start_, model.lp_.a_matrix_.index_, model.lp_.a_matrix_.value_
     // model.lp_.row_lower_, model.lp_.row_upper_
-    int number_of_rows = 0;
-    int A_non_zeros = 0;
+    /*
+        Rows are being numbered first (only L, U), then A is being written column by column (look ColumnwiseModelBuilder)
+        column of {i,c} has non zeros in row of i-th truck (condition 1) and in rows of orders of c-th chain (condition 2)
+    */
+    static constexpr int NO_ROW = -1;
 
     /*
         encoding condition 1 (from assignment problem): 
         each truck suppose to take no more than one chain
     */
+    std::vector<int>& truck_row = truck_row_;
+    truck_row.assign(trucks_count, NO_ROW);
     for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const auto& chains = chains_by_truck_pos[truck_pos];
-        const size_t chains_count = chains.size();
-        
-        if (chains_count == 0) continue;
-        // not empty row => +1 row in matrix A
-        ++number_of_rows;
-        
+        if (chain_generator.GetTruckChains(truck_pos).empty()) continue;
+
         // L[this_row] <= A[this_row] * X <= R[this_row] 
         // we want sum of picked chains to be 0 or 1
-        model.lp_.row_lower_.push_back(0);
-        model.lp_.row_upper_.push_back(1);
-
-        // setting number of non zero variables in current row of A matrix
-        A_non_zeros += chains_count;
-        model.lp_.a_matrix_.start_.push_back(A_non_zeros);
-
-        // creating row in A matrix
-        for (size_t chain_pos = 0; chain_pos < chains_count; ++chain_pos) {
-            // A[this_row][{i,c}] = 1
-            model.lp_.a_matrix_.index_.push_back(to_index[{truck_pos, chain_pos}]);
-            model.lp_.a_matrix_.value_.push_back(1);
-        }
+        truck_row[truck_pos] = builder.AddRow(0, 1);
     }
 
     /*
@@ -133,57 +107,87 @@ HighsModel ChainSolver::CreateModel() {
         picked chains must not intersect by orders that belong to this chains
         (intersection of chains {0, 1} and {1, 2} is {1} for example)
     */
-    // for order with order_pos provides set of indexes of variables {i, c} such that order belong to chain 'c'   
-    std::vector<std::vector<size_t>> vars_by_order_pos(orders_count);
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const auto& chains = chains_by_truck_pos[truck_pos];
-        const size_t chains_count = chains.size();
-        
-        for (size_t chain_pos = 0; chain_pos < chains_count; ++chain_pos) {
-            const Chain& chain = chains[chain_pos];
-            size_t chain_len = chain.GetEndPos();
-
-            for (size_t i = 0; i < chain_len; ++i) {
-                size_t order_pos = chain[i];
-
-                vars_by_order_pos[order_pos].push_back(to_index[{truck_pos, chain_pos}]);
-            }
+    // for order with order_pos provides row (only if order belongs to some chain)
+    std::vector<int>& order_row = order_row_;
+    order_row.assign(orders_count, NO_ROW);
+    const ChainPool& pool = chain_generator.GetPool();
+    for (size_t chain_pos = 0; chain_pos < pool.Size(); ++chain_pos) {
+        for (size_t order_pos : pool[chain_pos]) {
+            order_row[order_pos] = 0;
         }
     }
-
     for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
-        const size_t vars_count = vars_by_order_pos[order_pos].size();
-        if (vars_count == 0) continue;
+        if (order_row[order_pos] == NO_ROW) continue;
 
-        // not empty row => +1 row in matrix A
-        ++number_of_rows;
-        
         // L[this_row] <= A[this_row] * X <= R[this_row] 
         /*
             we want sum of picked chains that contains order with 'order_pos' to be 0 or 1
             Note: if order with order_pos has obligation = 1 we can make at least one truck pick it by setting L[this_row] = 1
         */
-        model.lp_.row_lower_.push_back(orders.GetOrderConst(order_pos).obligation);
-        model.lp_.row_upper_.push_back(1);
-
-        // setting number of non zero variables in current row of A matrix
-        A_non_zeros += vars_count;
-        model.lp_.a_matrix_.start_.push_back(A_non_zeros);
-
-        // creating row in A matrix
-        for (size_t var_index : vars_by_order_pos[order_pos]) {
-            // A[this_row][var_index] = 1
-            model.lp_.a_matrix_.index_.push_back(var_index);
-            model.lp_.a_matrix_.value_.push_back(1);
-        }
+        order_row[order_pos] = builder.AddRow(orders.GetOrderConst(order_pos).obligation, 1);
+    }
+
+    // setting number of rows in l,u,x (number of variables)
+    builder.SetColumnsCount(cur_var_id);
+    // chains of trucks go one after another in pool - position of chain in pool is its column
+    for (size_t chain_pos = 0; chain_pos < pool.Size(); ++chain_pos) {
+        builder.SetNonZerosCount(chain_pos, 1 + pool.GetLength(chain_pos));
     }
+    builder.AllocateNonZeros();
+
+    // processing c + creating columns in A matrix
+    // model.lp_.col_cost_
+    cur_var_id = 0;
+    std::vector<int> rows;
+    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+        for (ChainView chain : chain_generator.GetTruckChains(truck_pos)) {
+            builder.SetColumn(cur_var_id++, chain.revenue, 0, 1);
+
+            // A[row of i-th truck][{i,c}] = 1, A[row of order][{i,c}] = 1 for every order of c-th chain
+            // Note: rows of trucks go before rows of orders
+            builder.AddNonZero(truck_row[truck_pos], 1);
 
-    // number of rows in A,L,U
-    model.lp_.num_row_ = number_of_rows;
+            rows.clear();
+            for (size_t order_pos : chain) {
+                rows.push_back(order_row[order_pos]);
+            }
+            std::sort(rows.begin(), rows.end());
+            for (int row : rows) {
+                builder.AddNonZero(row, 1);
+            }
+        }
+    }
+    builder.Finish();
+
+    // rows and columns are identified by ids of trucks and orders they are made of (look HighsSession)
+    // Note: GenerateColumns keeps its own HighsSession between rounds
+    model_keys_.Clear();
+    if (options_.persistent_session || options_.chain_column_generation) {
+        model_keys_.rows.resize(model.lp_.num_row_);
+        model_keys_.cols.reserve(model.lp_.num_col_);
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            unsigned int truck_id = trucks.GetTruckConst(truck_pos).truck_id;
+            if (truck_row[truck_pos] != NO_ROW) {
+                model_keys_.rows[truck_row[truck_pos]] = CombineKey(1, truck_id);
+            }
+            for (ChainView chain : chain_generator.GetTruckChains(truck_pos)) {
+                uint64_t key = CombineKey(3, truck_id);
+                for (size_t order_pos : chain) {
+                    key = CombineKey(key, Solver::GetOrderKey(orders.GetOrderConst(order_pos)));
+                }
+                model_keys_.cols.push_back(key);
+            }
+        }
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            if (order_row[order_pos] != NO_ROW) {
+                model_keys_.rows[order_row[order_pos]] = CombineKey(2, Solver::GetOrderKey(orders.GetOrderConst(order_pos)));
+            }
+        }
+    }
 
     #ifdef DEBUG_MODE
-    cout << "number of rows in A: " << number_of_rows << endl
-        << "number of non zeros variables in A: " << A_non_zeros << endl;
+    cout << "number of rows in A: " << model.lp_.num_row_ << endl
+        << "number of non zeros variables in A: " << builder.GetNonZerosCount() << endl;
     #endif
 
     #ifdef DEBUG_MODE
@@ -192,9 +196,190 @@ HighsModel ChainSolver::CreateModel() {
     return model;
 }
 
+void ChainSolver::GenerateColumns(std::chrono::steady_clock::time_point deadline) {
+    static constexpr double eps = 1e-7;
+
+    const Trucks& trucks = data_.trucks;
+    const Orders& orders = data_.orders;
+    const size_t trucks_count = trucks.Size();
+    const size_t orders_count = orders.Size();
+
+    // orders of chain without its free-movement edge
+    const size_t max_len = mx_chain_len_;
+    assert(max_len >= 1);
+
+    // weights of each truck are weights_pos in [truck_first_weight[truck_pos], truck_first_weight[truck_pos + 1])
+    std::vector<FreeMovementWeight> weights(edges_w_vecs_.begin(), edges_w_vecs_.end());
+    std::vector<size_t> truck_first_weight(trucks_count + 1, weights.size());
+    for (size_t weight_pos = weights.size(); weight_pos-- > 0;) {
+        truck_first_weight[weights[weight_pos].truck_pos] = weight_pos;
+    }
+    for (size_t truck_pos = trucks_count; truck_pos-- > 0;) {
+        truck_first_weight[truck_pos] = std::min(truck_first_weight[truck_pos], truck_first_weight[truck_pos + 1]);
+    }
+
+    // Note: indexes are lazy - building them before threads start
+    const LongestPathFinder finder(data_);
+
+    const size_t threads_count = ResolveThreadsCount(options_.prepare_threads, trucks_count);
+
+    // buffers of one thread: chain of truck is being ended by best free-movement edge of its last order (if it has any)
+    struct PricingScratch {
+        LongestPathFinder::Scratch path;
+        std::vector<double> end_revenues;
+        std::vector<size_t> end_weight_pos;
+    };
+    std::vector<PricingScratch> scratches(threads_count);
+    for (PricingScratch& scratch : scratches) {
+        scratch.end_revenues.assign(orders_count, 0.);
+        scratch.end_weight_pos.assign(orders_count, weights.size());
+    }
+
+    // chain can be priced again only because of tolerances - keys of known chains stop such loops
+    auto chain_key = [&](size_t truck_pos, const ChainView& chain) {
+        uint64_t key = CombineKey(3, trucks.GetTruckConst(truck_pos).truck_id);
+        for (size_t order_pos : chain) {
+            key = CombineKey(key, Solver::GetOrderKey(orders.GetOrderConst(order_pos)));
+        }
+        return key;
+    };
+    std::unordered_set<uint64_t> known_chains;
+    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+        for (ChainView chain : chain_generator.GetTruckChains(truck_pos)) {
+            known_chains.insert(chain_key(truck_pos, chain));
+        }
+    }
+
+    HighsSession session;
+    session.GetHighs().setOptionValue("output_flag", false);
+    ApplyOptions(session.GetHighs(), options_);
+
+    std::vector<double> penalties(orders_count);
+    std::vector<double> truck_duals(trucks_count);
+    std::vector<ChainPool> priced_chains(trucks_count);
+    std::vector<ChainPool> new_chains(trucks_count);
+    for (size_t round = 0;; ++round) {
+        double time_left = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+        if (time_left <= 0.) {
+            break;
+        }
+
+        HighsModel model = CreateModel();
+        // Note: Update resets clocks of HiGHS - round gets only time left
+        session.Update(model, model_keys_);
+        Highs& highs = session.GetHighs();
+        HighsStatus return_status = highs.setOptionValue("time_limit", time_left);
+        assert(return_status==HighsStatus::kOk);
+        return_status = highs.run();
+        assert(return_status!=HighsStatus::kError);
+        if (highs.getModelStatus() != HighsModelStatus::kOptimal) {
+            break;
+        }
+
+        // for maximization HiGHS gives duals with reduced cost = cost - column * duals
+        const std::vector<double>& row_dual = highs.getSolution().row_dual;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            penalties[order_pos] = (order_row_[order_pos] != -1 ? row_dual[session.GetRowPos(order_row_[order_pos])] : 0.);
+        }
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            truck_duals[truck_pos] = (truck_row_[truck_pos] != -1 ? row_dual[session.GetRowPos(truck_row_[truck_pos])] : 0.);
+        }
+        // free-movement orders only end chains (look below)
+        std::vector<double> path_penalties = penalties;
+        for (size_t order_pos = real_orders_count; order_pos < orders_count; ++order_pos) {
+            path_penalties[order_pos] = LongestPathFinder::FORBIDDEN;
+        }
+
+        auto price = [&](size_t truck_pos, PricingScratch& scratch) {
+            priced_chains[truck_pos].Clear();
+
+            // orders with free-movement edges have to be followed by one of them (look ChainGenerator::AddWeightsEdges)
+            double empty_revenue = 0.;
+            size_t empty_weight_pos = weights.size();
+            for (size_t weight_pos = truck_first_weight[truck_pos]; weight_pos < truck_first_weight[truck_pos + 1]; ++weight_pos) {
+                const FreeMovementWeight& w = weights[weight_pos];
+                double revenue = w.weight - penalties[free_edge_order_pos_[weight_pos]];
+                if (w.order_pos == Solver::ffo_pos) {
+                    if (revenue > empty_revenue) {
+                        empty_revenue = revenue;
+                        empty_weight_pos = weight_pos;
+                    }
+                    continue;
+                }
+                if (scratch.end_weight_pos[w.order_pos] == weights.size() || revenue > scratch.end_revenues[w.order_pos]) {
+                    scratch.end_revenues[w.order_pos] = revenue;
+                    scratch.end_weight_pos[w.order_pos] = weight_pos;
+                }
+            }
+
+            LongestPathFinder::Path path = finder.Find(truck_pos, path_penalties, max_len, scratch.path, &scratch.end_revenues, empty_revenue);
+            size_t weight_pos = (path.orders.empty() ? empty_weight_pos : scratch.end_weight_pos[path.orders.back()]);
+
+            for (size_t pos = truck_first_weight[truck_pos]; pos < truck_first_weight[truck_pos + 1]; ++pos) {
+                if (weights[pos].order_pos != Solver::ffo_pos) {
+                    scratch.end_revenues[weights[pos].order_pos] = 0.;
+                    scratch.end_weight_pos[weights[pos].order_pos] = weights.size();
+                }
+            }
+
+            if (path.revenue - truck_duals[truck_pos] <= eps || (path.orders.empty() && weight_pos == weights.size())) {
+                return;
+            }
+
+            // real revenue of chain - penalties are being given back
+            double revenue = path.revenue;
+            for (size_t order_pos : path.orders) {
+                revenue += penalties[order_pos];
+            }
+            if (weight_pos != weights.size()) {
+                path.orders.push_back(free_edge_order_pos_[weight_pos]);
+                revenue += penalties[free_edge_order_pos_[weight_pos]];
+            }
+            priced_chains[truck_pos].Add(path.orders, revenue);
+        };
+
+        ParallelForEach(threads_count, trucks_count, [&](size_t truck_pos, size_t thread) {
+            price(truck_pos, scratches[thread]);
+        });
+
+        size_t added = 0;
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            new_chains[truck_pos].Clear();
+            const ChainPool& chains = priced_chains[truck_pos];
+            for (size_t chain_pos = 0; chain_pos < chains.Size(); ++chain_pos) {
+                if (known_chains.insert(chain_key(truck_pos, chains[chain_pos])).second) {
+                    new_chains[truck_pos].Add(chains[chain_pos]);
+                    ++added;
+                }
+            }
+        }
+        chain_generator.AddChains(new_chains);
+
+        #ifdef DEBUG_MODE
+        cout << "column generation round " << round << ": objective " << highs.getInfo().objective_function_value
+            << ", added chains " << added << endl;
+        #endif
+        if (added == 0) {
+            break;
+        }
+    }
+}
+
 solution_t ChainSolver::Solve() {
+    // column generation and final MIP share options_.time_limit
+    const SolverOptions options = options_;
+    if (options_.chain_column_generation) {
+        auto start = std::chrono::steady_clock::now();
+        // Note: time_limit is infinite by default (seconds of duration are being capped)
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(std::min(options.time_limit, 1e9)));
+        GenerateColumns(deadline);
+        double spent = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        options_.time_limit = std::max(0., options.time_limit - spent);
+    }
     auto model = CreateModel();
     std::vector<size_t> setted_columns = Solver::Solve(model);
+    options_ = options;
 
     std::vector<std::vector<size_t>> orders_by_truck_pos(data_.trucks.Size(), std::vector<size_t>());
     size_t orders_count = data_.orders.Size();
@@ -207,13 +392,8 @@ solution_t ChainSolver::Solve() {
     for(size_t var : setted_columns) {
         auto& [truck_pos, chain_pos] = to_2d_variables[var];
         
-        const std::vector<std::vector<Chain>>& chains_by_truck_pos = chain_generator.chains_by_truck_pos;
-        const Chain& chain = chains_by_truck_pos[truck_pos][chain_pos];
-
-        size_t chain_len = chain.GetEndPos();
-        for (size_t i = 0; i < chain_len; ++i) {
-            size_t order_pos = chain[i];
-
+        ChainView chain = chain_generator.GetTruckChains(truck_pos)[chain_pos];
+        for (size_t order_pos : chain) {
             orders_by_truck_pos[truck_pos].push_back(order_pos);
         }
     }
@@ -221,5 +401,5 @@ solution_t ChainSolver::Solve() {
     #ifdef DEBUG_MODE
     cout << "CHAIN_SOLVER_DEBUG##" << endl;
     #endif
-    return {orders_by_truck_pos};
+    return {orders_by_truck_pos, last_solve_stats_.status};
 }
\ No newline at end of file
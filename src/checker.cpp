@@ -20,8 +20,9 @@ static std::string epoch_to_utc(long epoch) {
 }
 
 std::optional<double> Checker::Check() {
-    auto print_city = [id_to_real_city = &data_.id_to_real_city](unsigned int city) {
-        unsigned int real_city = (*id_to_real_city)[city];
+    auto print_city = [&id_to_real_city = data_.GetIdToRealCityConst()](unsigned int city) {
+        auto it = id_to_real_city.find(city);
+        unsigned int real_city = (it != id_to_real_city.end() ? it->second : 0);
         return real_city;
     };
 
@@ -40,7 +41,7 @@ std::optional<double> Checker::Check() {
     auto& params = data_.params;
     auto& trucks = data_.trucks;
     auto& orders = data_.orders;
-    auto& dists = data_.dists;
+    const Distances& dists = data_.GetDistsConst();
 
 
     // each truck has its own set of cheduled orders (might be empty set)
@@ -0,0 +1,140 @@
+#include "compatibility_index.h"
+
+#include <algorithm>
+
+#ifdef DEBUG_MODE
+using std::cout;
+using std::endl;
+void CompatibilityIndex::DebugPrint() const {
+    cout<<"##COMPATIBILITY_INDEX_DEBUG:"<<endl
+        <<"trucks is "<<truck_class_.size()<<" (classes "<<truck_class_masks_.size()<<")"<<endl
+        <<"orders is "<<order_class_.size()<<" (classes "<<order_class_masks_.size()<<")"<<endl;
+    for (size_t truck_class = 0; truck_class < truck_class_masks_.size(); ++truck_class) {
+        size_t executable = 0;
+        for (uint64_t word : orders_bitset_[truck_class]) {
+            executable += __builtin_popcountll(word);
+        }
+        cout<<"truck class "<<truck_class
+            <<" {"<<truck_class_masks_[truck_class].first<<", "<<truck_class_masks_[truck_class].second<<"}"
+            <<" executable orders is "<<executable<<endl;
+    }
+    cout<<"COMPATIBILITY_INDEX_DEBUG##"<<endl<<endl;
+}
+#endif
+
+bool CompatibilityIndex::IsBuiltFor(const Trucks& trucks, const Orders& orders) const {
+    if (trucks.Size() != truck_masks_.size() || orders.Size() != order_masks_.size()) {
+        return false;
+    }
+    for (size_t truck_pos = 0; truck_pos < trucks.Size(); ++truck_pos) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        if (truck_masks_[truck_pos] != masks_t{truck.mask_load_type, truck.mask_trailer_type}) {
+            return false;
+        }
+    }
+    for (size_t order_pos = 0; order_pos < orders.Size(); ++order_pos) {
+        const Order& order = orders.GetOrderConst(order_pos);
+        if (order_masks_[order_pos] != masks_t{order.mask_load_type, order.mask_trailer_type}) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompatibilityIndex::Build(const Trucks& trucks, const Orders& orders) {
+    // checking if we can only append new orders
+    bool same_prefix = trucks.Size() == truck_masks_.size() && orders.Size() >= order_masks_.size();
+    for (size_t truck_pos = 0; same_prefix && truck_pos < trucks.Size(); ++truck_pos) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        same_prefix = truck_masks_[truck_pos] == masks_t{truck.mask_load_type, truck.mask_trailer_type};
+    }
+    for (size_t order_pos = 0; same_prefix && order_pos < order_masks_.size(); ++order_pos) {
+        const Order& order = orders.GetOrderConst(order_pos);
+        same_prefix = order_masks_[order_pos] == masks_t{order.mask_load_type, order.mask_trailer_type};
+    }
+    if (same_prefix) {
+        AddOrders(orders, order_masks_.size());
+        return;
+    }
+
+    *this = CompatibilityIndex();
+
+    for (size_t truck_pos = 0; truck_pos < trucks.Size(); ++truck_pos) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        masks_t masks = {truck.mask_load_type, truck.mask_trailer_type};
+
+        trucks_bits_.first |= masks.first;
+        trucks_bits_.second |= masks.second;
+        truck_masks_.push_back(masks);
+
+        // there is only a handful of classes - linear search is fine
+        auto it = std::find(truck_class_masks_.begin(), truck_class_masks_.end(), masks);
+        truck_class_.push_back(it - truck_class_masks_.begin());
+        if (it == truck_class_masks_.end()) {
+            truck_class_masks_.push_back(masks);
+        }
+    }
+    orders_bitset_.resize(truck_class_masks_.size());
+
+    AddOrders(orders, 0);
+}
+
+void CompatibilityIndex::AddOrders(const Orders& orders, size_t first_order_pos) {
+    const size_t orders_count = orders.Size();
+    const size_t words_count = (orders_count + 63) / 64;
+    for (std::vector<uint64_t>& bitset : orders_bitset_) {
+        bitset.resize(words_count, 0);
+    }
+
+    for (size_t order_pos = first_order_pos; order_pos < orders_count; ++order_pos) {
+        const Order& order = orders.GetOrderConst(order_pos);
+        masks_t masks = {order.mask_load_type, order.mask_trailer_type};
+        order_masks_.push_back(masks);
+
+        masks_t class_masks = {masks.first & trucks_bits_.first, masks.second & trucks_bits_.second};
+        auto it = std::find(order_class_masks_.begin(), order_class_masks_.end(), class_masks);
+        size_t order_class = it - order_class_masks_.begin();
+        order_class_.push_back(order_class);
+        if (it == order_class_masks_.end()) {
+            order_class_masks_.push_back(class_masks);
+
+            // the only IsExecutableBy calls - once per {truck class, order class}
+            std::vector<uint32_t>& truck_classes = truck_classes_by_order_class_.emplace_back();
+            for (size_t truck_class = 0; truck_class < truck_class_masks_.size(); ++truck_class) {
+                const masks_t& truck_masks = truck_class_masks_[truck_class];
+                // same as IsExecutableBy with full masks of the order
+                if (IsExecutableBy(truck_masks.first, truck_masks.second, class_masks.first, class_masks.second)) {
+                    truck_classes.push_back(truck_class);
+                }
+            }
+        }
+
+        for (uint32_t truck_class : truck_classes_by_order_class_[order_class]) {
+            orders_bitset_[truck_class][order_pos >> 6] |= uint64_t(1) << (order_pos & 63);
+        }
+    }
+}
+
+size_t CompatibilityIndex::GetTruckClassesCount() const {
+    return truck_class_masks_.size();
+}
+
+size_t CompatibilityIndex::GetOrderClassesCount() const {
+    return order_class_masks_.size();
+}
+
+size_t CompatibilityIndex::GetTruckClass(size_t truck_pos) const {
+    return truck_class_[truck_pos];
+}
+
+size_t CompatibilityIndex::GetOrderClass(size_t order_pos) const {
+    return order_class_[order_pos];
+}
+
+size_t CompatibilityIndex::CountExecutableOrders(size_t truck_pos) const {
+    size_t count = 0;
+    for (uint64_t word : orders_bitset_[truck_class_[truck_pos]]) {
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
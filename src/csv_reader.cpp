@@ -0,0 +1,497 @@
+#include "csv_reader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <deque>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // days since UNIX epoch by proleptic Gregorian date (day may be out of month range - its linear)
+    long long DaysFromCivil(long long y, long long m, long long d) {
+        y -= m <= 2;
+        const long long era = (y >= 0 ? y : y - 399) / 400;
+        const long long yoe = y - era * 400;
+        const long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    // inverse of DaysFromCivil (same fields as gmtime fills)
+    std::tm CivilFromSeconds(long long seconds) {
+        long long z = seconds / 86400;
+        long long rem = seconds % 86400;
+        if (rem < 0) {
+            rem += 86400;
+            --z;
+        }
+        z += 719468;
+        const long long era = (z >= 0 ? z : z - 146096) / 146097;
+        const long long doe = z - era * 146097;
+        const long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const long long mp = (5 * doy + 2) / 153;
+        const long long m = mp < 10 ? mp + 3 : mp - 9;
+
+        std::tm t{};
+        t.tm_year = static_cast<int>(yoe + era * 400 + (m <= 2) - 1900);
+        t.tm_mon = static_cast<int>(m - 1);
+        t.tm_mday = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+        t.tm_hour = static_cast<int>(rem / 3600);
+        t.tm_min = static_cast<int>(rem / 60 % 60);
+        t.tm_sec = static_cast<int>(rem % 60);
+        t.tm_isdst = 0;
+        return t;
+    }
+
+    bool IsNumber(std::string_view s) {
+        // from_chars accepts "inf"/"nan" - they are strings for us
+        if (s.empty() || !(std::isdigit(static_cast<unsigned char>(s[0])) || s[0] == '-' || s[0] == '.')) {
+            return false;
+        }
+        double x;
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), x);
+        return ec == std::errc() && ptr == s.data() + s.size();
+    }
+
+    // same rules as XLCellValueProxy::type for numeric cells
+    bool IsFloat(std::string_view s) {
+        return s.find('.') != std::string_view::npos
+            || s.find("E-") != std::string_view::npos
+            || s.find("e-") != std::string_view::npos;
+    }
+
+    double ParseDouble(std::string_view s) {
+        double x = 0.;
+        std::from_chars(s.data(), s.data() + s.size(), x);
+        return x;
+    }
+
+    long long ParseInteger(std::string_view s) {
+        long long x = 0;
+        std::from_chars(s.data(), s.data() + s.size(), x);
+        return x;
+    }
+
+    // reads exactly 'digits' digits starting from 'pos', moves 'pos'
+    bool ReadInt(std::string_view s, size_t& pos, size_t digits, int& x) {
+        if (pos + digits > s.size()) {
+            return false;
+        }
+        auto [ptr, ec] = std::from_chars(s.data() + pos, s.data() + pos + digits, x);
+        if (ec != std::errc() || ptr != s.data() + pos + digits) {
+            return false;
+        }
+        pos += digits;
+        return true;
+    }
+
+    bool ReadChar(std::string_view s, size_t& pos, char ch) {
+        if (pos < s.size() && s[pos] == ch) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    /*
+        "YYYY-MM-DD[ T]HH:MM[:SS]", "DD.MM.YYYY[ HH:MM[:SS]]" (time is optional for both)
+        tm_isdst is -1 same as XLDateTime::tm does
+    */
+    std::optional<std::tm> ParseDateTime(std::string_view s) {
+        std::tm t{};
+        t.tm_isdst = -1;
+        int year = 0, month = 0, day = 0;
+        size_t pos = 0;
+        if (s.size() >= 10 && s[4] == '-') {
+            if (!ReadInt(s, pos, 4, year) || !ReadChar(s, pos, '-')
+                || !ReadInt(s, pos, 2, month) || !ReadChar(s, pos, '-')
+                || !ReadInt(s, pos, 2, day)) {
+                return std::nullopt;
+            }
+        } else if (s.size() >= 10 && s[2] == '.') {
+            if (!ReadInt(s, pos, 2, day) || !ReadChar(s, pos, '.')
+                || !ReadInt(s, pos, 2, month) || !ReadChar(s, pos, '.')
+                || !ReadInt(s, pos, 4, year)) {
+                return std::nullopt;
+            }
+        } else {
+            return std::nullopt;
+        }
+        if (pos < s.size()) {
+            if (!ReadChar(s, pos, ' ') && !ReadChar(s, pos, 'T')) {
+                return std::nullopt;
+            }
+            if (!ReadInt(s, pos, 2, t.tm_hour) || !ReadChar(s, pos, ':') || !ReadInt(s, pos, 2, t.tm_min)) {
+                return std::nullopt;
+            }
+            if (ReadChar(s, pos, ':') && !ReadInt(s, pos, 2, t.tm_sec)) {
+                return std::nullopt;
+            }
+            if (pos != s.size()) {
+                return std::nullopt;
+            }
+        }
+        if (month < 1 || month > 12 || day < 1 || day > 31 || t.tm_hour > 23 || t.tm_min > 59 || t.tm_sec > 60) {
+            return std::nullopt;
+        }
+        t.tm_year = year - 1900;
+        t.tm_mon = month - 1;
+        t.tm_mday = day;
+        return t;
+    }
+
+    char GuessSeparator(std::string_view first_line) {
+        const char candidates[] = {',', ';', '\t'};
+        char best = ',';
+        size_t best_count = 0;
+        for (char ch : candidates) {
+            size_t count = std::count(first_line.begin(), first_line.end(), ch);
+            if (count > best_count) {
+                best = ch;
+                best_count = count;
+            }
+        }
+        return best;
+    }
+
+    bool EndsWith(const std::string& s, const std::string& suffix) {
+        if (s.size() < suffix.size()) {
+            return false;
+        }
+        return std::equal(suffix.rbegin(), suffix.rend(), s.rbegin(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        });
+    }
+}
+
+////////////////////
+// LocalTimeCache //
+////////////////////
+
+time_t LocalTimeCache::MakeTime(const std::tm& t) {
+    // local wall clock seconds of the hour start (as if it was UTC)
+    long long hour_start = (DaysFromCivil(t.tm_year + 1900LL, t.tm_mon + 1LL, t.tm_mday) * 24 + t.tm_hour) * 3600;
+    int isdst = t.tm_isdst < 0 ? -1 : (t.tm_isdst > 0 ? 1 : 0);
+    long long key = hour_start * 4 + (isdst + 1);
+
+    auto it = offsets_.find(key);
+    if (it == offsets_.end()) {
+        std::tm hour = t;
+        hour.tm_min = 0;
+        hour.tm_sec = 0;
+        it = offsets_.emplace(key, static_cast<long long>(mktime(&hour)) - hour_start).first;
+    }
+    return static_cast<time_t>(hour_start + it->second + t.tm_min * 60LL + t.tm_sec);
+}
+
+unsigned int GetTimeFromSerial(double serial, LocalTimeCache& time_cache) {
+    tm t = XLDateTime(serial).tm();
+    return (time_cache.MakeTime(t) + three_hours + 59)/60;
+}
+
+unsigned int GetTimeFromSerialDays(int serial_days, LocalTimeCache& time_cache) {
+    long long y = (1LL * serial_days * 24 * 60 * 60 - serial_unix_offset);
+    tm t = CivilFromSeconds(y);
+    return (time_cache.MakeTime(t) + three_hours + 59)/60;
+}
+
+/////////////
+// CSVCell //
+/////////////
+
+CSVCell::CSVCell(const std::vector<CSVField>* row, LocalTimeCache* time_cache) :
+    row_(row), time_cache_(time_cache) {}
+
+const CSVField& CSVCell::field() const {
+    static const CSVField empty;
+    if (is_end()) {
+        return empty;
+    }
+    return (*row_)[pos_];
+}
+
+void CSVCell::next() {
+    ++pos_;
+}
+
+bool CSVCell::is_end() const {
+    return pos_ >= row_->size();
+}
+
+XLValueType CSVCell::get_type() const {
+    const CSVField& f = field();
+    std::string_view v = f.value;
+    if (v.empty()) {
+        return XLValueType::Empty;
+    }
+    if (IsNumber(v)) {
+        return IsFloat(v) ? XLValueType::Float : XLValueType::Integer;
+    }
+    return XLValueType::String;
+}
+
+template<>
+std::string CSVCell::get_value() const {
+    return std::string(field().value);
+}
+
+template<typename T>
+std::optional<T> CSVCell::get_num_value() const {
+    std::string_view v = field().value;
+
+    T x;
+    switch (get_type())
+    {
+    case XLValueType::Float: {
+        x = static_cast<float>(ParseDouble(v));
+        break;
+    }
+
+    case XLValueType::Integer: {
+        x = static_cast<int>(ParseInteger(v));
+        break;
+    }
+
+    default:
+        #ifdef DEBUG_MODE
+        std::cerr << "not expected field(" << v << ") in get_num_value" << std::endl;
+        #endif
+        return std::nullopt;
+    }
+    return {x};
+}
+
+std::optional<unsigned int> CSVCell::get_time_value() const {
+    const CSVField& f = field();
+    std::string_view v = f.value;
+
+    unsigned int x;
+    switch (get_type())
+    {
+    case XLValueType::Float: {
+        x = GetTimeFromSerial(ParseDouble(v), *time_cache_);
+        break;
+    }
+
+    case XLValueType::Integer: {
+        x = GetTimeFromSerialDays(static_cast<int>(ParseInteger(v)), *time_cache_);
+        break;
+    }
+
+    case XLValueType::String: {
+        std::optional<std::tm> t = ParseDateTime(v);
+        if (!t) {
+            #ifdef DEBUG_MODE
+            std::cerr << "not expected field(" << v << ") in get_time_value" << std::endl;
+            #endif
+            return std::nullopt;
+        }
+        x = (time_cache_->MakeTime(t.value()) + three_hours + 59)/60;
+        break;
+    }
+
+    default:
+        return std::nullopt;
+    }
+    return {x};
+}
+
+template std::optional<double> CSVCell::get_num_value() const;
+template std::optional<unsigned int> CSVCell::get_num_value() const;
+
+///////////////
+// CSVReader //
+///////////////
+
+class CSVReader::Impl {
+public:
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    char separator = ',';
+
+    std::vector<CSVField> row;
+    // unescaped quoted fields of current row (deque - references stay valid on push_back)
+    std::deque<std::string> unescaped;
+    LocalTimeCache time_cache;
+
+    size_t rows = 0;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    Impl(const std::string &path_to_csv, char separator_) {
+        int fd = open(path_to_csv.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "CSVReader: cant open " << path_to_csv << std::endl;
+            exit(1);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            std::cerr << "CSVReader: cant stat " << path_to_csv << std::endl;
+            exit(1);
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* raw = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (raw == MAP_FAILED) {
+                close(fd);
+                std::cerr << "CSVReader: cant mmap " << path_to_csv << std::endl;
+                exit(1);
+            }
+            madvise(raw, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(raw);
+        }
+        close(fd);
+
+        // UTF-8 BOM (Excel puts it into "CSV UTF-8" files)
+        if (size >= 3 && std::string_view(data, 3) == "\xEF\xBB\xBF") {
+            pos = 3;
+        }
+
+        if (separator_ != 0) {
+            separator = separator_;
+        } else if (EndsWith(path_to_csv, ".tsv")) {
+            separator = '\t';
+        } else if (size == 0) {
+            // empty file has no rows (and 'data' isnt mapped) - separator doesnt matter
+            separator = ',';
+        } else {
+            const char* line_end = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+            separator = GuessSeparator(std::string_view(data + pos, (line_end ? line_end : data + size) - (data + pos)));
+        }
+    }
+
+    ~Impl() {
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    bool NextRow() {
+        row.clear();
+        unescaped.clear();
+        if (pos >= size) {
+            return false;
+        }
+
+        while (true) {
+            CSVField field;
+            if (pos < size && data[pos] == '"') {
+                field.value = ReadQuotedField();
+            } else {
+                size_t start = pos;
+                while (pos < size && data[pos] != separator && data[pos] != '\n') {
+                    ++pos;
+                }
+                size_t end = pos;
+                if (end > start && data[end - 1] == '\r' && (pos >= size || data[pos] == '\n')) {
+                    --end;
+                }
+                field.value = std::string_view(data + start, end - start);
+            }
+            row.push_back(field);
+
+            if (pos < size && data[pos] == separator) {
+                ++pos;
+                continue;
+            }
+            // skipping garbage after closing quote up to the end of the field
+            while (pos < size && data[pos] != '\n' && data[pos] != separator) {
+                ++pos;
+            }
+            if (pos < size && data[pos] == separator) {
+                ++pos;
+                continue;
+            }
+            if (pos < size) {
+                ++pos; // '\n'
+            }
+            break;
+        }
+        ++rows;
+        return true;
+    }
+
+private:
+    std::string_view ReadQuotedField() {
+        ++pos; // opening quote
+        size_t start = pos;
+        std::string* buffer = nullptr;
+        while (pos < size) {
+            if (data[pos] != '"') {
+                ++pos;
+                continue;
+            }
+            if (pos + 1 < size && data[pos + 1] == '"') {
+                // escaped quote - field cant be a view into the file anymore
+                if (buffer == nullptr) {
+                    buffer = &unescaped.emplace_back();
+                }
+                buffer->append(data + start, pos + 1 - start);
+                pos += 2;
+                start = pos;
+                continue;
+            }
+            break;
+        }
+        size_t end = std::min(pos, size);
+        if (pos < size) {
+            ++pos; // closing quote
+        }
+        if (buffer == nullptr) {
+            return std::string_view(data + start, end - start);
+        }
+        buffer->append(data + start, end - start);
+        return *buffer;
+    }
+};
+
+CSVReader::CSVReader(const std::string &path_to_csv, char separator) :
+    impl_(std::make_unique<Impl>(path_to_csv, separator)) {}
+
+CSVReader::~CSVReader() = default;
+
+bool CSVReader::IsCSVPath(const std::string &path) {
+    return EndsWith(path, ".csv") || EndsWith(path, ".tsv");
+}
+
+bool CSVReader::NextRow() {
+    return impl_->NextRow();
+}
+
+CSVCell CSVReader::FirstCell() const {
+    return CSVCell(&impl_->row, &impl_->time_cache);
+}
+
+CSVReader::Stats CSVReader::GetStats() const {
+    Stats stats;
+    stats.rows = impl_->rows;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - impl_->start_time).count();
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        stats.peak_rss_kb = usage.ru_maxrss;
+    }
+    return stats;
+}
+
+#ifdef DEBUG_MODE
+void CSVReader::DebugPrintStats(const std::string &name) const {
+    Stats stats = GetStats();
+    cout << std::fixed << std::setprecision(3)
+        << "##CSV_READER_DEBUG:" << endl
+        << "file is " << name << endl
+        << "rows is " << stats.rows << endl
+        << "seconds is " << stats.seconds << endl
+        << "rows/sec is " << stats.GetRowsPerSecond() << endl
+        << "peak_rss_kb is " << stats.peak_rss_kb << endl
+        << "CSV_READER_DEBUG##" << endl << endl;
+}
+#endif
@@ -1,27 +1,106 @@
 #include "data.h"
 
+#include <chrono>
+#include <future>
+
+#ifdef DEBUG_MODE
+void DataLoadTimings::DebugPrint() const {
+    cout<<std::fixed<<std::setprecision(5)
+        <<"##DATA_LOAD_TIMINGS_DEBUG:"<<endl
+        <<"params is "<<params<<endl
+        <<"trucks is "<<trucks<<endl
+        <<"orders is "<<orders<<endl
+        <<"dists is "<<dists<<endl
+        <<"post_processing is "<<post_processing<<endl
+        <<"total is "<<total<<endl
+        <<"DATA_LOAD_TIMINGS_DEBUG##"<<endl<<endl;
+}
+#endif
+
+template <class T>
+static std::future<double> LoadAsync(T& target, const std::string &path) {
+    return std::async(std::launch::async, [&target, &path]() {
+        auto start = std::chrono::steady_clock::now();
+        target = T(path);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+}
+
 Data::Data(
     const std::string &params_path,
     const std::string &trucks_path,
     const std::string &orders_path,
     const std::string &dists_path
-):  params(params_path),
-    trucks(trucks_path),
-    orders(orders_path),
-    dists(dists_path) 
-{
+) {
+    auto start = std::chrono::steady_clock::now();
+
+    // each file is being parsed by its own thread
+    std::future<double> params_loading = LoadAsync(params, params_path);
+    std::future<double> trucks_loading = LoadAsync(trucks, trucks_path);
+    std::future<double> orders_loading = LoadAsync(orders, orders_path);
+    std::future<double> dists_loading = LoadAsync(GetDistsRef(), dists_path);
+
+    load_timings.params = params_loading.get();
+    load_timings.trucks = trucks_loading.get();
+    load_timings.orders = orders_loading.get();
+    load_timings.dists = dists_loading.get();
+
+    auto post_processing_start = std::chrono::steady_clock::now();
     ShiftTimestamps();
     SqueezeCitiesIds();
+
+    auto finish = std::chrono::steady_clock::now();
+    load_timings.post_processing = std::chrono::duration<double>(finish - post_processing_start).count();
+    load_timings.total = std::chrono::duration<double>(finish - start).count();
+
+    #ifdef DEBUG_MODE
+    load_timings.DebugPrint();
+    #endif
 }
 
 Data::Data(const Data& other): 
+    min_timestamp(other.min_timestamp),
+    cities_count(other.cities_count),
     params(other.params), 
     trucks(other.trucks),
     orders(other.orders),
-    dists(other.dists),
+    load_timings(other.load_timings),
+    dists_(other.dists_),
+    id_to_real_city_(other.id_to_real_city_),
+    compatibility_(other.compatibility_),
+    successors_(other.successors_) {}
+
+Data::Data(const Data& other, const std::vector<Truck>& trucks, const std::vector<Order>& orders): 
     min_timestamp(other.min_timestamp),
-    id_to_real_city(other.id_to_real_city),
-    cities_count(other.cities_count) {}
+    cities_count(other.cities_count),
+    params(other.params), 
+    trucks(trucks),
+    orders(orders),
+    load_timings(other.load_timings),
+    dists_(other.dists_),
+    id_to_real_city_(other.id_to_real_city_) {}
+
+const Distances& Data::GetDistsConst() const {
+    return *dists_;
+}
+
+Distances& Data::GetDistsRef() {
+    if (dists_.use_count() > 1) {
+        dists_ = std::make_shared<Distances>(*dists_);
+    }
+    return *dists_;
+}
+
+const std::unordered_map<unsigned int, unsigned int>& Data::GetIdToRealCityConst() const {
+    return *id_to_real_city_;
+}
+
+std::unordered_map<unsigned int, unsigned int>& Data::GetIdToRealCityRef() {
+    if (id_to_real_city_.use_count() > 1) {
+        id_to_real_city_ = std::make_shared<std::unordered_map<unsigned int, unsigned int>>(*id_to_real_city_);
+    }
+    return *id_to_real_city_;
+}
 
 void Data::ShiftTimestamps() {
     min_timestamp = UINT32_MAX;
@@ -42,9 +121,12 @@ void Data::ShiftTimestamps() {
 }
 
 void Data::SqueezeCitiesIds() {
+    std::unordered_map<unsigned int, unsigned int>& id_to_real_city = GetIdToRealCityRef();
+    Distances& dists = GetDistsRef();
+
     std::unordered_map<unsigned int, unsigned int> real_city_to_id;
     unsigned int cur = 1;
-    auto squeeze_city = [&cur, &real_city_to_id, this](unsigned int real_city) -> unsigned int {
+    auto squeeze_city = [&cur, &real_city_to_id, &id_to_real_city](unsigned int real_city) -> unsigned int {
         // havent encountered this city yet
         auto it = real_city_to_id.find(real_city);
         if (it == real_city_to_id.end()) {
@@ -71,20 +153,30 @@ void Data::SqueezeCitiesIds() {
     dists.dists = squeezed_dists;
 
     cities_count = id_to_real_city.size();
+
+    // cities ids are dense now so we can use matrix for distances (if there is not too many cities)
+    dists.BuildMatrix(cities_count);
+}
+
+
+std::optional<double> Data::GetDistance(unsigned int from_city, unsigned int to_city) const {
+    return dists_->GetDistance(from_city, to_city);
 }
 
+unsigned int Data::GetArrivingTime(const Order& previous, double distance) const {
+    return previous.finish_time + distance * 60 / params.speed;
+}
 
 std::optional<double> Data::CostMovingBetweenOrders(const Order& previous, const Order& current) const {
     double cost = 0.;
 
-    auto dist_between_orders = dists.GetDistance(previous.to_city, current.from_city); 
+    auto dist_between_orders = GetDistance(previous.to_city, current.from_city);
     if (!dist_between_orders.has_value())
         return std::nullopt;
-
     double d = dist_between_orders.value();
     cost -= GetFreeMovementCost(d);
 
-    unsigned int arriving_time = previous.finish_time + d * 60 / params.speed;
+    unsigned int arriving_time = GetArrivingTime(previous, d);
     if (arriving_time > current.start_time)
         return std::nullopt;
 
@@ -137,3 +229,20 @@ double Data::GetFreeMovementCost(double distance) const {
 double Data::GetWaitingCost(double mins) const {
     return mins * params.wait_cost / 60.;
 }
+
+const CompatibilityIndex& Data::GetCompatibility() const {
+    if (!compatibility_.IsBuiltFor(trucks, orders)) {
+        compatibility_.Build(trucks, orders);
+    }
+    return compatibility_;
+}
+
+const SuccessorIndex& Data::GetSuccessors() const {
+    if (!successors_ || !successors_->IsBuiltFor(*this)) {
+        // previous index is being reused if orders were only appended (look SuccessorIndex::Build)
+        auto successors = std::make_shared<SuccessorIndex>();
+        successors->Build(*this, successors_.get());
+        successors_ = std::move(successors);
+    }
+    return *successors_;
+}
@@ -0,0 +1,372 @@
+#include "data_snapshot.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t fingerprint;
+        uint64_t trucks_count;
+        uint64_t orders_count;
+        uint64_t dists_count;
+        // (cities_count + 1)^2 doubles of dense matrix (0 - sparse mode, only distances records)
+        uint64_t matrix_size;
+        uint64_t matrix_roads_count;
+        uint64_t cities_count;
+        uint64_t id_to_real_city_count;
+        uint32_t min_timestamp;
+        // sizes of records - making sure we wont read snapshot written by incompatible build
+        uint16_t truck_record_size;
+        uint16_t order_record_size;
+    };
+
+    struct ParamsRecord {
+        double speed;
+        double free_km_cost;
+        double free_hour_cost;
+        double wait_cost;
+        double duty_km_cost;
+        double duty_hour_cost;
+    };
+
+    struct TruckRecord {
+        uint32_t truck_id;
+        int32_t mask_load_type;
+        int32_t mask_trailer_type;
+        uint32_t init_time;
+        uint32_t init_city;
+        uint32_t padding;
+    };
+
+    struct OrderRecord {
+        uint32_t order_id;
+        uint32_t obligation;
+        uint32_t start_time;
+        uint32_t finish_time;
+        uint32_t from_city;
+        uint32_t to_city;
+        int32_t mask_load_type;
+        int32_t mask_trailer_type;
+        double distance;
+        double revenue;
+    };
+
+    struct DistanceRecord {
+        uint32_t from;
+        uint32_t to;
+        double distance;
+    };
+
+    struct CityRecord {
+        uint32_t id;
+        uint32_t real_city;
+    };
+
+    static_assert(sizeof(SnapshotHeader) % 8 == 0);
+    static_assert(sizeof(ParamsRecord) % 8 == 0);
+    static_assert(sizeof(TruckRecord) % 8 == 0);
+    static_assert(sizeof(OrderRecord) % 8 == 0);
+    static_assert(sizeof(DistanceRecord) % 8 == 0);
+    static_assert(sizeof(CityRecord) % 8 == 0);
+
+    size_t GetSnapshotSize(const SnapshotHeader& header) {
+        return sizeof(SnapshotHeader)
+            + sizeof(ParamsRecord)
+            + header.trucks_count * sizeof(TruckRecord)
+            + header.orders_count * sizeof(OrderRecord)
+            + header.matrix_size * sizeof(double)
+            + header.dists_count * sizeof(DistanceRecord)
+            + header.id_to_real_city_count * sizeof(CityRecord);
+    }
+
+    template<typename T>
+    void HashCombine(uint64_t& seed, const T& v) {
+        seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+    }
+
+    template<typename T>
+    void WriteRecords(std::ofstream& out, const std::vector<T>& records) {
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+    }
+}
+
+uint64_t DataSnapshot::Fingerprint(const std::vector<std::string> &paths) {
+    uint64_t seed = 0;
+    for (const std::string& path : paths) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            size = 0;
+        }
+        uint64_t mtime = 0;
+        auto raw_mtime = std::filesystem::last_write_time(path, ec);
+        if (!ec) {
+            mtime = raw_mtime.time_since_epoch().count();
+        }
+        HashCombine(seed, path);
+        HashCombine(seed, size);
+        HashCombine(seed, mtime);
+    }
+    return seed;
+}
+
+bool DataSnapshot::Write(const Data& data, const std::string &path, uint64_t fingerprint) {
+    const Params& params = data.params;
+    const Trucks& trucks = data.trucks;
+    const Orders& orders = data.orders;
+    // snapshot of small Data keeps dense matrix even if it wasnt built yet - reader maps it as it is
+    Distances dense_dists;
+    if (!data.GetDistsConst().IsDense() && data.cities_count <= Distances::MX_DENSE_CITIES) {
+        dense_dists = data.GetDistsConst();
+        dense_dists.BuildMatrix(data.cities_count);
+    }
+    const Distances& dists = dense_dists.IsDense() ? dense_dists : data.GetDistsConst();
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.fingerprint = fingerprint;
+    header.trucks_count = trucks.Size();
+    header.orders_count = orders.Size();
+    header.cities_count = data.cities_count;
+    header.id_to_real_city_count = data.GetIdToRealCityConst().size();
+    header.min_timestamp = data.min_timestamp;
+    header.truck_record_size = sizeof(TruckRecord);
+    header.order_record_size = sizeof(OrderRecord);
+
+    ParamsRecord params_record{
+        params.speed,
+        params.free_km_cost,
+        params.free_hour_cost,
+        params.wait_cost,
+        params.duty_km_cost,
+        params.duty_hour_cost
+    };
+
+    std::vector<TruckRecord> trucks_records;
+    trucks_records.reserve(trucks.Size());
+    for (size_t truck_pos = 0; truck_pos < trucks.Size(); ++truck_pos) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        trucks_records.push_back(TruckRecord{
+            truck.truck_id,
+            truck.mask_load_type,
+            truck.mask_trailer_type,
+            truck.init_time,
+            truck.init_city,
+            0
+        });
+    }
+
+    std::vector<OrderRecord> orders_records;
+    orders_records.reserve(orders.Size());
+    for (size_t order_pos = 0; order_pos < orders.Size(); ++order_pos) {
+        const Order& order = orders.GetOrderConst(order_pos);
+        orders_records.push_back(OrderRecord{
+            order.order_id,
+            order.obligation,
+            order.start_time,
+            order.finish_time,
+            order.from_city,
+            order.to_city,
+            order.mask_load_type,
+            order.mask_trailer_type,
+            order.distance,
+            order.revenue
+        });
+    }
+
+    // dense mode: matrix is being written as it is, records are only roads which dont fit it
+    if (dists.IsDense()) {
+        const size_t row_size = data.cities_count + 1;
+        header.matrix_size = row_size * row_size;
+    }
+
+    // std::map is sorted by {from, to} so records are sorted too
+    std::vector<DistanceRecord> dists_records;
+    dists_records.reserve(dists.dists.size());
+    size_t records_roads_count = 0;
+    for (const auto& [from_to, d] : dists.dists) {
+        dists_records.push_back(DistanceRecord{from_to.first, from_to.second, d});
+        records_roads_count += from_to.first != from_to.second;
+    }
+    header.dists_count = dists_records.size();
+    header.matrix_roads_count = dists.RoadsCount() - records_roads_count;
+
+    std::vector<CityRecord> cities_records;
+    cities_records.reserve(data.GetIdToRealCityConst().size());
+    for (const auto& [id, real_city] : data.GetIdToRealCityConst()) {
+        cities_records.push_back(CityRecord{id, real_city});
+    }
+
+    /*
+        Note: Data read before still maps old file - new one is being written aside and then renamed over it
+        (truncating mapped file would break these Data)
+    */
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "DataSnapshot::Write: cant open " << tmp_path << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&params_record), sizeof(params_record));
+        WriteRecords(out, trucks_records);
+        WriteRecords(out, orders_records);
+        if (dists.IsDense()) {
+            out.write(reinterpret_cast<const char*>(dists.GetMatrix()), header.matrix_size * sizeof(double));
+        }
+        WriteRecords(out, dists_records);
+        WriteRecords(out, cities_records);
+        out.close();
+        if (!out) {
+            std::cerr << "DataSnapshot::Write: cant write " << tmp_path << std::endl;
+            std::filesystem::remove(tmp_path);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::cerr << "DataSnapshot::Write: cant rename " << tmp_path << " to " << path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<Data> DataSnapshot::Read(const std::string &path, uint64_t fingerprint) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        return std::nullopt;
+    }
+    const size_t file_size = st.st_size;
+
+    void* raw = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (raw == MAP_FAILED) {
+        return std::nullopt;
+    }
+    // mapping lives while dense matrix of loaded Data (or its copies) uses it
+    std::shared_ptr<const char> mapping(static_cast<const char*>(raw), [file_size](const char* p) {
+        munmap(const_cast<char*>(p), file_size);
+    });
+    const char* ptr = mapping.get();
+
+    const SnapshotHeader& header = *reinterpret_cast<const SnapshotHeader*>(ptr);
+    if (header.magic != MAGIC
+        || header.version != VERSION
+        || header.fingerprint != fingerprint
+        || header.truck_record_size != sizeof(TruckRecord)
+        || header.order_record_size != sizeof(OrderRecord)
+        || GetSnapshotSize(header) != file_size
+        || (header.matrix_size != 0 && header.matrix_size != (header.cities_count + 1) * (header.cities_count + 1))
+    ) {
+        return std::nullopt;
+    }
+    ptr += sizeof(SnapshotHeader);
+
+    Data data;
+    data.min_timestamp = header.min_timestamp;
+    data.cities_count = header.cities_count;
+
+    {
+        const ParamsRecord& p = *reinterpret_cast<const ParamsRecord*>(ptr);
+        data.params = Params{
+            p.speed,
+            p.free_km_cost,
+            p.free_hour_cost,
+            p.wait_cost,
+            p.duty_km_cost,
+            p.duty_hour_cost
+        };
+        ptr += sizeof(ParamsRecord);
+    }
+
+    {
+        const TruckRecord* records = reinterpret_cast<const TruckRecord*>(ptr);
+        std::vector<Truck> trucks(header.trucks_count);
+        for (size_t truck_pos = 0; truck_pos < header.trucks_count; ++truck_pos) {
+            const TruckRecord& r = records[truck_pos];
+            Truck& truck = trucks[truck_pos];
+            truck.truck_id = r.truck_id;
+            truck.mask_load_type = r.mask_load_type;
+            truck.mask_trailer_type = r.mask_trailer_type;
+            truck.init_time = r.init_time;
+            truck.init_city = r.init_city;
+        }
+        data.trucks = Trucks(trucks);
+        ptr += header.trucks_count * sizeof(TruckRecord);
+    }
+
+    {
+        const OrderRecord* records = reinterpret_cast<const OrderRecord*>(ptr);
+        std::vector<Order> orders;
+        orders.reserve(header.orders_count);
+        for (size_t order_pos = 0; order_pos < header.orders_count; ++order_pos) {
+            const OrderRecord& r = records[order_pos];
+            orders.emplace_back(
+                r.order_id,
+                static_cast<bool>(r.obligation),
+                r.start_time,
+                r.finish_time,
+                r.from_city,
+                r.to_city,
+                r.mask_load_type,
+                r.mask_trailer_type,
+                r.distance,
+                r.revenue
+            );
+        }
+        data.orders = Orders(orders);
+        ptr += header.orders_count * sizeof(OrderRecord);
+    }
+
+    if (header.matrix_size != 0) {
+        // aliasing pointer - matrix is being used right from the mapping
+        data.GetDistsRef().SetMatrix(
+            std::shared_ptr<const double[]>(mapping, reinterpret_cast<const double*>(ptr)),
+            header.cities_count,
+            header.matrix_roads_count
+        );
+        ptr += header.matrix_size * sizeof(double);
+    }
+
+    {
+        const DistanceRecord* records = reinterpret_cast<const DistanceRecord*>(ptr);
+        auto& dists = data.GetDistsRef().dists;
+        for (size_t i = 0; i < header.dists_count; ++i) {
+            const DistanceRecord& r = records[i];
+            // records are sorted so inserting in the end of map is amortized O(1)
+            dists.emplace_hint(dists.end(), std::make_pair(r.from, r.to), r.distance);
+        }
+        ptr += header.dists_count * sizeof(DistanceRecord);
+    }
+
+    {
+        const CityRecord* records = reinterpret_cast<const CityRecord*>(ptr);
+        auto& id_to_real_city = data.GetIdToRealCityRef();
+        id_to_real_city.reserve(header.id_to_real_city_count);
+        for (size_t i = 0; i < header.id_to_real_city_count; ++i) {
+            id_to_real_city.emplace(records[i].id, records[i].real_city);
+        }
+    }
+
+    return data;
+}
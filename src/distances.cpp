@@ -5,32 +5,29 @@ using std::cout;
 using std::endl;
 void Distances::DebugPrint() {
     cout<<"##DISTANCE_DEBUG:"<<endl;
-    for(auto &[from_to, d] : dists) {
-        auto [from, to] = from_to;
+    ForEachRoad([](unsigned int from, unsigned int to, double d) {
         cout<<std::fixed<<std::setprecision(5)
             <<"from_city is "<<from<<endl
             <<"to_city is "<<to<<endl
             <<"distance is "<<d<<endl
             <<"##"<<endl;
-    }
+    });
     cout<<"DISTANCE_DEBUG##"<<endl<<endl;
 }
 #endif
 
 
 Distances::Distances(const std::string &path_to_xlsx) {
-    XLDocument doc;
-    doc.open(path_to_xlsx);
-    auto worksheet = doc.workbook().worksheet("Sheet1");
+    TableReader reader(path_to_xlsx);
 
     bool is_need_skip_header = 1;
-    for (auto& row : worksheet.rows()) {
+    while (reader.NextRow()) {
         if(is_need_skip_header) {
             is_need_skip_header = false;
             continue;
         }
         
-        XLSXcell cell(row.cells().begin());
+        TableCell cell = reader.FirstCell();
         if(cell.get_type()==XLValueType::Empty) {
             break;
         }
@@ -41,7 +38,7 @@ Distances::Distances(const std::string &path_to_xlsx) {
         auto to = cell.get_num_value<unsigned int>();
         cell.next();
 
-        if(cell.get_raw_iterator()==row.cells().end()) continue;
+        if(cell.is_end()) continue;
 
         auto d = cell.get_num_value<double>();
         cell.next();
@@ -50,6 +47,71 @@ Distances::Distances(const std::string &path_to_xlsx) {
             dists[{from.value(),to.value()}] = d.value() / 1000; 
         }     
     }
+
+    #ifdef DEBUG_MODE
+    reader.DebugPrintStats(path_to_xlsx);
+    #endif
+}
+
+void Distances::BuildMatrix(size_t cities_count) {
+    // roads of previous matrix are going back to map first - matrix is being built from all of them
+    if (IsDense()) {
+        std::map<std::pair<unsigned int,unsigned int>, double> roads;
+        ForEachRoad([&roads](unsigned int from, unsigned int to, double d) {
+            roads.emplace(std::make_pair(from, to), d);
+        });
+        dists.swap(roads);
+    }
+    matrix_.reset();
+    row_size_ = 0;
+    matrix_roads_count_ = 0;
+    if (cities_count > MX_DENSE_CITIES) {
+        // staying in sparse mode
+        return;
+    }
+
+    row_size_ = cities_count + 1;
+    std::shared_ptr<double[]> matrix(new double[row_size_ * row_size_]);
+    std::fill_n(matrix.get(), row_size_ * row_size_, NO_ROAD);
+    for (size_t city = 0; city < row_size_; ++city) {
+        matrix[city * row_size_ + city] = 0.;
+    }
+    for (auto it = dists.begin(); it != dists.end();) {
+        auto [from, to] = it->first;
+        if (!IsInMatrix(from, to)) {
+            ++it;
+            continue;
+        }
+        if (from != to) {
+            matrix[from * row_size_ + to] = it->second;
+            ++matrix_roads_count_;
+        }
+        it = dists.erase(it);
+    }
+    matrix_ = std::move(matrix);
+}
+
+void Distances::SetMatrix(std::shared_ptr<const double[]> matrix, size_t cities_count, size_t roads_count) {
+    assert(matrix != nullptr && cities_count <= MX_DENSE_CITIES);
+    matrix_ = std::move(matrix);
+    row_size_ = cities_count + 1;
+    matrix_roads_count_ = roads_count;
+}
+
+const double* Distances::GetMatrix() const {
+    return matrix_.get();
+}
+
+bool Distances::IsDense() const {
+    return row_size_ > 0;
+}
+
+size_t Distances::RoadsCount() const {
+    size_t count = matrix_roads_count_;
+    for (const auto& [from_to, d] : dists) {
+        count += from_to.first != from_to.second;
+    }
+    return count;
 }
 
 std::optional<double> Distances::GetDistance(unsigned int from, unsigned int to) const {
@@ -57,9 +119,17 @@ std::optional<double> Distances::GetDistance(unsigned int from, unsigned int to)
         return 0.;
     }
 
+    if (IsInMatrix(from, to)) {
+        double d = GetDistanceFast(from, to);
+        if (d == NO_ROAD) {
+            return std::nullopt;
+        }
+        return {d};
+    }
+
     auto it = dists.find({from,to});
     if (it != dists.end()) {
         return {it->second};
     }
     return std::nullopt;
-}
\ No newline at end of file
+}
@@ -1,6 +1,13 @@
 #include "flow_solver.h"
 
-FlowSolver::FlowSolver() {}
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <map>
+#include <tuple>
+
+FlowSolver::FlowSolver(const SolverOptions& options) : Solver(options) {}
 
 void FlowSolver::SetData(const Data& data) {
     data_ = data;
@@ -12,6 +19,36 @@ const Data& FlowSolver::GetDataConst() const {
     return data_;
 }
 
+void FlowSolver::BuildTruckClasses() {
+    const Trucks& trucks = data_.trucks;
+    size_t trucks_count = trucks.Size();
+
+    truck_classes_.clear();
+    class_by_truck_pos_.assign(trucks_count, 0);
+
+    // everything that makes sub-graphs of two trucks different except truck_id
+    /*
+        Note: identical trucks of BatchSolver batch are being merged too - BatchSolver writes its per-truck bits of mask_load_type
+        into its own copy of trucks (look batch_solver.cpp), not into trucks of batch data.
+        Their free-movement weights are same as well (they depend only on this key).
+    */
+    typedef std::tuple<int, int, unsigned int, unsigned int> truck_key_t;
+    std::map<truck_key_t, size_t> class_by_key;
+    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        size_t truck_class = truck_classes_.size();
+        if (options_.aggregate_trucks) {
+            truck_key_t key = {truck.mask_load_type, truck.mask_trailer_type, truck.init_city, truck.init_time};
+            truck_class = class_by_key.emplace(key, truck_class).first->second;
+        }
+        if (truck_class == truck_classes_.size()) {
+            truck_classes_.emplace_back();
+        }
+        truck_classes_[truck_class].push_back(truck_pos);
+        class_by_truck_pos_[truck_pos] = truck_class;
+    }
+}
+
 static variable_t Get3dVariable(size_t x, size_t orders_count) {
     auto m = orders_count;
     size_t k = (x%m);   
@@ -21,32 +58,27 @@ static variable_t Get3dVariable(size_t x, size_t orders_count) {
 }
 
 HighsModel FlowSolver::CreateModel() {
-    Params params = data_.params;
-    Trucks trucks = data_.trucks;
-    Orders orders = data_.orders;    
-    Distances dists = data_.dists;
+    const Trucks& trucks = data_.trucks;
+    const Orders& orders = data_.orders;
 
     size_t trucks_count = trucks.Size();
     size_t orders_count = orders.Size();    
 
     // c^Tx + d subject to L <= Ax <= U; l <= x <= u
     HighsModel model;
-    // maximizing revenue => kMaximize
-    model.lp_.sense_ = ObjSense::kMaximize;
-    // writing matrix A by rows
-    model.lp_.a_matrix_.format_ = MatrixFormat::kRowwise;
-    model.lp_.offset_ = 0;
+    // maximizing revenue => kMaximize, writing matrix A by columns
+    ColumnwiseModelBuilder builder(model, ObjSense::kMaximize);
 
-    // variable_t -> its index in vector X
+    // index in vector X -> its variable_t
     std::vector<variable_t> variables;
-    std::unordered_map<variable_t, size_t> to_index;
-    auto GetVariableIndex = [&to_index] (const variable_t& v) -> std::optional<size_t> {
-        auto it = to_index.find(v);
-        if (it == to_index.end()) {
-            return std::nullopt;
-        }
-        return it->second;
-    };
+
+    /*
+        Trucks with same masks, init_city and init_time have identical sub-graphs so with SolverOptions::aggregate_trucks
+        only first truck of such class gets variables and its ffo/flo rows get supply equal to size of class
+        (rows of orders still let each order be picked at most once => flow of class is splitted into paths, look Solve)
+    */
+    BuildTruckClasses();
+    size_t classes_count = truck_classes_.size();
 
 
     // processing l,u + storing non zero variables
@@ -56,105 +88,132 @@ HighsModel FlowSolver::CreateModel() {
 
         lets calculate l,u for l <= x <= u
         for every (i,j,k) -> i-th truck will pick k-th order after completing j-th order
+
+        Variables of each truck are independent from other trucks so trucks are being enumerated by several threads
+        (look SolverOptions::prepare_threads) into their own buffers. Variables are stored by sections:
+        (0) {i, j, k}, (1) {i, ffo, k}, (2) {i, j, flo}, (3) {i, ffo, flo}
+        and merged as all trucks of section 0, then all trucks of section 1 and so on (same order for any count of threads)
     */
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        Truck truck = trucks.GetTruck(truck_pos);
+    static constexpr size_t sections_count = 4;
+    typedef std::array<std::vector<variable_t>, sections_count> sections_t;
 
-        for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
-            const Order& from_order = orders.GetOrderConst(from_order_pos);
+    // only orders executable by truck are being iterated (instead of checking IsExecutableBy for every pair)
+    // Note: indexes are lazy - building them before threads start
+    const CompatibilityIndex& compatibility = data_.GetCompatibility();
+    const SuccessorIndex& successors = data_.GetSuccessors();
 
-            if (!IsExecutableBy(
-                truck.mask_load_type, 
-                truck.mask_trailer_type, 
-                from_order.mask_load_type, 
-                from_order.mask_trailer_type)
-            ) { // bad trailer or load type
-                continue;
-            }
+    auto enumerate_truck_variables = [&](size_t truck_pos, sections_t& sections) {
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
 
-            for (size_t to_order_pos = 0; to_order_pos < orders_count; ++to_order_pos) {
-                const Order& to_order = orders.GetOrderConst(to_order_pos);
+        compatibility.ForEachExecutableOrder(truck_pos, [&](size_t from_order_pos) {
+            const Order& from_order = orders.GetOrderConst(from_order_pos);
 
-                int u = 1; 
-                if (from_order_pos == to_order_pos) { // cant pick same order twice
-                    u = 0;
-                } else {
-                    auto cost = data_.MoveBetweenOrders(truck, from_order, to_order);
-                    u &= cost.has_value(); // possible to arrive to k-th after j-th + k-th order is executable by i-th truck
+            // its not necessary for correctness to check if j-th order can be picked by i-th truck (it will be checked later anyway)
+            // but it will reduce amount of variables
+            if (truck.init_time > from_order.start_time) {
+                return;
+            }
 
-                    // its not necessary for correctness to check if j-th order can be picked by i-th truck (it will be checked later anyway)
-                    // but it will reduce amount of variables
-                    u &= (truck.init_time <= from_order.start_time);
+            // only k-th orders which are possible to arrive to after j-th are being iterated (look successors)
+            successors.ForEachSuccessor(from_order_pos, [&](size_t to_order_pos, double) {
+                // cant pick same order twice
+                if (from_order_pos == to_order_pos) {
+                    return;
                 }
-
-                if (u != 0) {
-                    variables.push_back({truck_pos, from_order_pos, to_order_pos});
+                if (compatibility.IsExecutable(truck_pos, to_order_pos)) {
+                    sections[0].push_back({truck_pos, from_order_pos, to_order_pos});
                 }
-            }
-        }
-    }
-    // lets add additional variables for later use
-    // fake first order for each truck
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const Truck& truck = trucks.GetTruckConst(truck_pos);
-
-        // our fake first order (state after completing it <=> initial state of truck)
-        Order from_order = Solver::make_ffo(truck);
+            });
+        });
 
-        for (size_t to_order_pos = 0; to_order_pos < orders_count; ++to_order_pos) {
-            const Order& to_order = orders.GetOrderConst(to_order_pos);
-            int u = 1; 
+        // lets add additional variables for later use
+        // fake first order for each truck
+        {
+            // our fake first order (state after completing it <=> initial state of truck)
+            Order from_order = Solver::make_ffo(truck);
 
             // we suppose to let any truck pick fake first order so we wont check any conditions for this order
             // but we have to check conditions for i-th truck and k-th order because it will be his real first order 
-            auto cost = data_.MoveBetweenOrders(truck, from_order, to_order);
-            u &= cost.has_value();
+            compatibility.ForEachExecutableOrder(truck_pos, [&](size_t to_order_pos) {
+                const Order& to_order = orders.GetOrderConst(to_order_pos);
 
-            if (u != 0) {
-                variables.push_back({truck_pos, Solver::ffo_pos, to_order_pos});
-            }
+                if (data_.MoveBetweenOrders(from_order, to_order).has_value()) {
+                    sections[1].push_back({truck_pos, Solver::ffo_pos, to_order_pos});
+                }
+            });
         }
-    }
-
-    // fake last order for each truck
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        const Truck& truck = trucks.GetTruckConst(truck_pos);
-
-        for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
-            const Order& from_order = orders.GetOrderConst(from_order_pos);
 
+        // fake last order for each truck
+        {
             // our fake last order (we suppose to make it pickable after any order)
             // we can set such configuration
             /*
             Order to_order = Solver::make_flo(from_order);
             */
             // but its more easier to just not check them
-            int u = 1; 
 
             // we suppose to let any truck pick fake last order so we wont check any conditions for this order
             // but we have to check conditions for i-th truck and j-th order because it will be his real last order 
-            if (!IsExecutableBy(
-                truck.mask_load_type, 
-                truck.mask_trailer_type, 
-                from_order.mask_load_type, 
-                from_order.mask_trailer_type)
-            ) { // bad trailer or load type
-                u = 0; 
-            } else {
+            compatibility.ForEachExecutableOrder(truck_pos, [&](size_t from_order_pos) {
+                const Order& from_order = orders.GetOrderConst(from_order_pos);
+
                 // its not necessary for correctness to check if j-th order can be picked by i-th truck (it will be checked later anyway)
                 // but it will reduce amount of variables
-                u &= (truck.init_time <= from_order.start_time);
+                if (truck.init_time <= from_order.start_time) {
+                    sections[2].push_back({truck_pos, from_order_pos, Solver::flo_pos});
+                }
+            });
+        }
+
+        // lets also let any truck to just pick only fake orders <=> simply not doing any real orders
+        sections[3].push_back({truck_pos, Solver::ffo_pos, Solver::flo_pos});
+    };
+
+    size_t threads_count = ResolveThreadsCount(options_.prepare_threads, classes_count);
+
+    // classes are being taken one by one by free threads, each class remembers where its variables are
+    struct TruckVariables {
+        size_t thread;
+        std::array<size_t, sections_count> begin;
+        std::array<size_t, sections_count> end;
+    };
+    std::vector<TruckVariables> truck_variables(classes_count);
+    std::vector<sections_t> thread_sections(threads_count);
+    std::atomic<size_t> next_class = 0;
+
+    auto enumerate = [&](size_t thread) {
+        sections_t& sections = thread_sections[thread];
+        for (size_t truck_class = next_class++; truck_class < classes_count; truck_class = next_class++) {
+            TruckVariables& location = truck_variables[truck_class];
+            location.thread = thread;
+            for (size_t section = 0; section < sections_count; ++section) {
+                location.begin[section] = sections[section].size();
+            }
+            enumerate_truck_variables(truck_classes_[truck_class].front(), sections);
+            for (size_t section = 0; section < sections_count; ++section) {
+                location.end[section] = sections[section].size();
             }
+        }
+    };
+
+    ParallelFor(threads_count, enumerate);
 
-            if (u != 0) {
-                variables.push_back({truck_pos, from_order_pos, Solver::flo_pos});
+    // merging buffers (positions are prefix sums of counts by sections and trucks)
+    {
+        size_t variables_count = 0;
+        for (const TruckVariables& location : truck_variables) {
+            for (size_t section = 0; section < sections_count; ++section) {
+                variables_count += location.end[section] - location.begin[section];
             }
         }
-    }
+        variables.reserve(variables_count);
 
-    // lets also let any truck to just pick only fake orders <=> simply not doing any real orders
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        variables.push_back({truck_pos, Solver::ffo_pos, Solver::flo_pos});
+        for (size_t section = 0; section < sections_count; ++section) {
+            for (const TruckVariables& location : truck_variables) {
+                const std::vector<variable_t>& buffer = thread_sections[location.thread][section];
+                variables.insert(variables.end(), buffer.begin() + location.begin[section], buffer.begin() + location.end[section]);
+            }
+        }
     }
 
     #ifdef DEBUG_MODE
@@ -162,17 +221,12 @@ HighsModel FlowSolver::CreateModel() {
     #endif
 
     // filtering variables
-    PreSolver pre_solver(variables);
+    PreSolver pre_solver(variables, options_.prepare_threads);
     variables = pre_solver.GetFilteredVariables();
     
-    // mapping variables to its indices in the model(indices of its columns) and vice versa
+    // mapping indices of variables in the model(indices of its columns) to variables
     for (size_t index = 0; index < variables.size(); ++index) {
-        const variable_t& var = variables[index];
-
-        to_index[var] = index;
-        to_3d_variables[index] = var;
-        model.lp_.col_lower_.push_back(0);
-        model.lp_.col_upper_.push_back(1);          
+        to_3d_variables[index] = variables[index];
     }
 
     #ifdef DEBUG_MODE
@@ -205,53 +259,122 @@ HighsModel FlowSolver::CreateModel() {
     std::cout << "non zero variables: " << to_3d_variables.size() << " (out of " << trucks_count*(orders_count+1)*(orders_count+1) << ")" << std::endl;
     #endif
 
-    // setting number of rows in l,u,x (number of variables)
-    model.lp_.num_col_ = to_3d_variables.size();
-
-    // processing c
-    // model.lp_.col_cost_
-    model.lp_.col_cost_.resize(model.lp_.num_col_);
-    for (auto &el : to_3d_variables) {
-        size_t ind = el.first;
-        const auto& [truck_pos, from_order_pos, to_order_pos] = el.second;
-        const Truck& truck = trucks.GetTruckConst(truck_pos);
-        
-        double c = 0.;
-
-        if (from_order_pos != Solver::ffo_pos) {
-            // real revenue from completing j-th order (revenue - duty_time_cost - duty_km_cost)
-            c += data_.GetRealOrderRevenue(from_order_pos);
+    // A
+    // L, U
+    // model.lp_.a_matrix_.start_, model.lp_.a_matrix_.index_, model.lp_.a_matrix_.value_
+    // model.lp_.row_lower_, model.lp_.row_upper_
+    /*
+        Rows are being numbered first (only L, U), then A is being written column by column (look ColumnwiseModelBuilder)
+        rows (in this order):
+        (1) condition 1 for every {i-th truck, j-th order} with at least one edge (truck-major order)
+        (2) condition 2 for every order
+        (3) condition 3 (ffo) for every truck with at least one edge from its ffo
+        (4) condition 4 (flo) for every truck with at least one edge to its flo
+        so every variable {i,j,k} has at most 4 non zeros: (1) for j and k, (2) for j, (3) if j is ffo, (4) if k is flo
+
+        Rows (1) are being numbered by sorting real ends of variables by {i, j} (truck-major)
+        so it takes O(variables * log(variables)) - there is no trucks_count x orders_count table
+    */
+    static constexpr int NO_ROW = -1;
+    // {i * orders_count + j, end of variable (2 * ind for its from order, 2 * ind + 1 for its to order)}
+    std::vector<std::pair<uint64_t, size_t>> balance_ends;
+    balance_ends.reserve(2 * variables.size());
+    std::vector<int> ffo_row(trucks_count, NO_ROW);
+    std::vector<int> flo_row(trucks_count, NO_ROW);
+    std::vector<bool> has_outgoing(orders_count, false);
+    for (size_t ind = 0; ind < variables.size(); ++ind) {
+        const auto& [truck_pos, from_order_pos, to_order_pos] = variables[ind];
+        if (from_order_pos == Solver::ffo_pos) {
+            ffo_row[truck_pos] = 0;
+        } else {
+            balance_ends.emplace_back(static_cast<uint64_t>(truck_pos) * orders_count + from_order_pos, 2 * ind);
+            has_outgoing[from_order_pos] = true;
+        }
+        if (to_order_pos == Solver::flo_pos) {
+            flo_row[truck_pos] = 0;
+        } else {
+            balance_ends.emplace_back(static_cast<uint64_t>(truck_pos) * orders_count + to_order_pos, 2 * ind + 1);
         }
+    }
+    std::sort(balance_ends.begin(), balance_ends.end());
 
-        const Order& from_order = (from_order_pos != Solver::ffo_pos ? orders.GetOrderConst(from_order_pos) : Solver::make_ffo(truck));
-        const Order& to_order   = (to_order_pos != Solver::flo_pos  ? orders.GetOrderConst(to_order_pos) : Solver::make_flo(from_order));
+    #ifdef DEBUG_MODE
+    auto LU_debug = [] (int row, int L, int U) {
+        printf("L[%2d] = %2d, R[%2d] = %2d\n", row, L, row, U);
+    };
+    cout << "##INEQUALITIES_DEBUG (L, U)" << endl;
+    #endif
 
-        // cost of moving to to_order.from_city and waiting until we can start it
-        c += data_.CostMovingBetweenOrders(from_order, to_order).value();
+    // encoding condition 1: in sub-graph for i-th truck each vertex suppose to have equal incoming and outgoing degrees
+    // fake vertexes act like source/drain so we shouldn put this constraint on them
+    // we check for i-th truck that all edges he picked satisfies condition1
+    // L[this_row] <= A[this_row] * X <= R[this_row] 
+    // <=> summary outgoind degree + -1 * (summary incoming degree) = 0 
+    // balance_row[end of variable] (look balance_ends), balance_keys[row - first_balance_row] = i * orders_count + j
+    std::vector<int> balance_row(2 * variables.size(), NO_ROW);
+    std::vector<uint64_t> balance_keys;
+    const int first_balance_row = model.lp_.row_lower_.size();
+    for (const auto& [key, end] : balance_ends) {
+        if (balance_keys.empty() || balance_keys.back() != key) {
+            int row = builder.AddRow(0, 0);
+            balance_keys.push_back(key);
+            #ifdef DEBUG_MODE
+            LU_debug(row, 0, 0);
+            #endif
+        }
+        balance_row[end] = first_balance_row + balance_keys.size() - 1;
+    }
 
-        model.lp_.col_cost_[ind] = c;
+    // encoding condition 2: in all sub-graphs (for all trucks) each vertex suppose to have summary 0/1 outgoing degree
+    // for obligation order it suppose to be 1
+    const int first_order_row = model.lp_.row_lower_.size();
+    for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
+        bool obligation = orders.GetOrderConst(from_order_pos).obligation;
+        if (!has_outgoing[from_order_pos] && obligation) {
+            std::cerr << "Error in scheduling obligation order_id("
+                << orders.GetOrderConst(from_order_pos).order_id << "): no trucks can execute "
+                << from_order_pos << "-th order" << std::endl;
+            exit(1);
+        }
+        builder.AddRow(obligation, 1);
+        #ifdef DEBUG_MODE
+        LU_debug(first_order_row + from_order_pos, obligation, 1);
+        #endif
     }
-    #ifdef DEBUG_MODE
-    cout << "##COST_VECTOR_DEBUG" << endl; 
-    for (size_t ind = 0; ind < model.lp_.col_cost_.size(); ++ind) {
-        auto& [i,j,k] = to_3d_variables[ind];
-        double c = model.lp_.col_cost_[ind];
 
-        printf("C[{%2ld, %2ld, %2ld}] = %5f\n", i, j, k, c);
+    // for fake first order summary outgoing degree suppose to be trucks_count (its source of the graph) 
+    // but we will encode different constraint: in any given sub-graph it suppose to be 1 (its tighter one for our system)
+    // or size of truck class for sub-graph of the whole class
+    // fake last order - same stands for incoming degree
+    for (std::vector<int>* fake_order_row : {&ffo_row, &flo_row}) {
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            int& row = (*fake_order_row)[truck_pos];
+            if (row != NO_ROW) {
+                int supply = truck_classes_[class_by_truck_pos_[truck_pos]].size();
+                row = builder.AddRow(supply, supply);
+                #ifdef DEBUG_MODE
+                LU_debug(row, supply, supply);
+                #endif
+            }
+        }
     }
-    cout << "COST_VECTOR_DEBUG##" << endl; 
+
+    #ifdef DEBUG_MODE
+    cout << "INEQUALITIES_DEBUG (L, U)##" << endl;
     #endif
 
-    // A
-    // L, U
-    // model.lp_.a_matrix_.start_, model.lp_.a_matrix_.index_, model.lp_.a_matrix_.value_
-    // model.lp_.row_lower_, model.lp_.row_upper_
-    int number_of_rows = 0;
-    int A_non_zeros = 0;
+    // setting number of rows in l,u,x (number of variables)
+    builder.SetColumnsCount(variables.size());
+    for (size_t ind = 0; ind < variables.size(); ++ind) {
+        const auto& [truck_pos, from_order_pos, to_order_pos] = variables[ind];
+        size_t non_zeros_count = (from_order_pos == Solver::ffo_pos ? 1 : 2) + 1;
+        builder.SetNonZerosCount(ind, non_zeros_count);
+    }
+    builder.AllocateNonZeros();
 
     #ifdef DEBUG_MODE
-    auto A_matrix_element_debug = [this, &orders, &trucks, &number_of_rows, orders_count] (std::pair<size_t, int> &ind_val) {
-        const auto& [i,j,k] = to_3d_variables[ind_val.first];
+    auto A_matrix_element_debug = [this, &orders, &trucks, orders_count] (int row, size_t ind, int val) {
+        const auto& [i,j,k] = to_3d_variables[ind];
         std::string j_th_id = (j < orders_count 
             ? std::to_string(orders.GetOrderConst(j).order_id) 
             : 
@@ -267,251 +390,113 @@ HighsModel FlowSolver::CreateModel() {
                 : "flo"));        
         
         printf("A[%2d][{%2ld,%2ld,%2ld}] = %2d / truck_id(%2d) and edge(%4s, %4s)\n", 
-            number_of_rows, i, j, k, ind_val.second, trucks.GetTruckConst(i).truck_id, j_th_id.c_str(), k_th_id.c_str());
+            row, i, j, k, val, trucks.GetTruckConst(i).truck_id, j_th_id.c_str(), k_th_id.c_str());
     };
-    auto LU_debug = [&number_of_rows] (int L, int U) {
-        printf("L[%2d] = %2d, R[%2d] = %2d\n", number_of_rows, L, number_of_rows, U);
-    };
-    cout << "##INEQUALITIES_DEBUG (A matrix)" << endl;
+    cout << "##COST_VECTOR_DEBUG and INEQUALITIES_DEBUG (A matrix)" << endl;
     #endif
 
-    // encoding condition 1: in sub-graph for i-th truck each vertex suppose to have equal incoming and outgoing degrees
-    // fake vertexes act like source/drain so we shouldn put this constraint on them
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
-            std::vector<std::pair<size_t, int>> row_non_zeros;
-            
-            // to_order_pos in [0,orders_count-1] -> real orders
-            // to_order_pos = orders_count -> fake first one
-            // to_order_pos = orders_count+1 -> fake last one
-            for (size_t to_order_pos_i = 0; to_order_pos_i < orders_count + 1 + 1; ++to_order_pos_i) {
-                size_t to_order_pos = to_order_pos_i;
-                if (to_order_pos == orders_count) {
-                    to_order_pos = Solver::ffo_pos;
-                } else if (to_order_pos == orders_count + 1) {
-                    to_order_pos = Solver::flo_pos;
-                }
-
-                auto ind_from = GetVariableIndex({truck_pos, from_order_pos, to_order_pos});
-                auto ind_to = GetVariableIndex({truck_pos, to_order_pos, from_order_pos});
-                
-                if (ind_from.has_value()) {
-                    // A[this_row][{i,j,k}] += 1
-                    row_non_zeros.emplace_back(ind_from.value(), 1);
-                }
-                if (ind_to.has_value()) {
-                    // A[this_row][{i,k,j}] -= 1
-                    row_non_zeros.emplace_back(ind_to.value(), -1);
-                }
-            }
-            if (row_non_zeros.empty()) continue;
-            // not empty row => +1 row in matrix A
-            ++number_of_rows;
-
-            // we check for i-th truck that all edges he picked satisfies condition1
-            // L[this_row] <= A[this_row] * X <= R[this_row] 
-            // <=> summary outgoind degree + -1 * (summary incoming degree) = 0 
-            model.lp_.row_lower_.push_back(0);
-            model.lp_.row_upper_.push_back(0);
+    // processing c, l, u and column of A for every variable
+    // model.lp_.col_cost_, model.lp_.col_lower_, model.lp_.col_upper_
+    for (size_t ind = 0; ind < variables.size(); ++ind) {
+        const auto& [truck_pos, from_order_pos, to_order_pos] = variables[ind];
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        
+        double c = 0.;
 
-            // setting number of non zero variables in current row of A matrix
-            A_non_zeros += row_non_zeros.size();
-            model.lp_.a_matrix_.start_.push_back(A_non_zeros);
+        if (from_order_pos != Solver::ffo_pos) {
+            // real revenue from completing j-th order (revenue - duty_time_cost - duty_km_cost)
+            c += data_.GetRealOrderRevenue(from_order_pos);
+        }
 
-            #ifdef DEBUG_MODE
-            LU_debug(0, 0);
-            #endif
+        const Order& from_order = (from_order_pos != Solver::ffo_pos ? orders.GetOrderConst(from_order_pos) : Solver::make_ffo(truck));
+        const Order& to_order   = (to_order_pos != Solver::flo_pos  ? orders.GetOrderConst(to_order_pos) : Solver::make_flo(from_order));
 
-            for (auto &el : row_non_zeros) {
-                model.lp_.a_matrix_.index_.push_back(el.first);
-                model.lp_.a_matrix_.value_.push_back(el.second);
-                #ifdef DEBUG_MODE
-                A_matrix_element_debug(el);
-                #endif
-            }
+        // cost of moving to to_order.from_city and waiting until we can start it
+        c += data_.CostMovingBetweenOrders(from_order, to_order).value();
 
-            #ifdef DEBUG_MODE
-            cout<<"~~~~~~~~~~~~~~~~~~~~~~"<<endl;
-            #endif
+        // only {ffo, flo} can be picked by several trucks of class - any real order is being picked at most once
+        double upper = 1.;
+        if (from_order_pos == Solver::ffo_pos && to_order_pos == Solver::flo_pos) {
+            upper = truck_classes_[class_by_truck_pos_[truck_pos]].size();
         }
-    }
-    
-    // encoding condition 2: in all sub-graphs (for all trucks) each vertex suppose to have summary 0/1 outgoing degree
-    // for obligation order it suppose to be 1
-    for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
-        std::vector<std::pair<size_t, int>> row_non_zeros;
-
-        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-            // to_order_pos in [0,orders_count-1] -> real orders
-            // to_order_pos = orders_count -> fake first one
-            // to_order_pos = orders_count+1 -> fake last one
-            for (size_t to_order_pos_i = 0; to_order_pos_i < orders_count + 1 + 1; ++to_order_pos_i) {
-                size_t to_order_pos = to_order_pos_i;
-                if (to_order_pos == orders_count) {
-                    to_order_pos = Solver::ffo_pos;
-                } else if (to_order_pos == orders_count + 1) {
-                    to_order_pos = Solver::flo_pos;
-                }
+        builder.SetColumn(ind, c, 0, upper);
+        #ifdef DEBUG_MODE
+        printf("C[{%2ld, %2ld, %2ld}] = %5f\n", truck_pos, from_order_pos, to_order_pos, c);
+        #endif
 
-                // for fake last order we computing incoming degree
-                auto ind_from = GetVariableIndex({truck_pos, from_order_pos, to_order_pos});
-                
-                if (ind_from.has_value()) {
-                    // A[this_row][{i,j,k}] += 1
-                    row_non_zeros.emplace_back(ind_from.value(), 1);
-                }
-            }
+        // {row, value} - at most 4 non zeros (look above)
+        std::array<std::pair<int, int>, 4> non_zeros;
+        size_t non_zeros_count = 0;
+        if (from_order_pos == Solver::ffo_pos) {
+            // condition 3: outgoing degree of ffo
+            non_zeros[non_zeros_count++] = {ffo_row[truck_pos], 1};
+        } else {
+            // condition 1: A[row of {i,j}][{i,j,k}] += 1
+            non_zeros[non_zeros_count++] = {balance_row[2 * ind], 1};
+            // condition 2: A[row of j][{i,j,k}] += 1
+            non_zeros[non_zeros_count++] = {first_order_row + static_cast<int>(from_order_pos), 1};
         }
-        bool obligation = orders.GetOrderConst(from_order_pos).obligation;
-        if (row_non_zeros.empty()) {
-            if (obligation) {
-                std::cerr << "Error in scheduling obligation order_id("
-                    << orders.GetOrderConst(from_order_pos).order_id << "): no trucks can execute "
-                    << from_order_pos << "-th order" << std::endl;
-                exit(1);
-            }
+        if (to_order_pos == Solver::flo_pos) {
+            // condition 4: incoming degree of flo
+            non_zeros[non_zeros_count++] = {flo_row[truck_pos], 1};
+        } else {
+            // condition 1: A[row of {i,k}][{i,j,k}] -= 1
+            non_zeros[non_zeros_count++] = {balance_row[2 * ind + 1], -1};
         }
-        // not empty row => +1 row in matrix A
-        ++number_of_rows;
-
-        model.lp_.row_lower_.push_back(obligation);
-        model.lp_.row_upper_.push_back(1);
+        std::sort(non_zeros.begin(), non_zeros.begin() + non_zeros_count);
 
-        // setting number of non zero variables in current row of A matrix
-        A_non_zeros += row_non_zeros.size();
-        model.lp_.a_matrix_.start_.push_back(A_non_zeros);
-
-        #ifdef DEBUG_MODE
-        LU_debug(model.lp_.row_lower_.back(), model.lp_.row_upper_.back());
-        #endif
-        
-        for (auto &el : row_non_zeros) {
-            model.lp_.a_matrix_.index_.push_back(el.first);
-            model.lp_.a_matrix_.value_.push_back(el.second);
+        for (size_t pos = 0; pos < non_zeros_count; ++pos) {
+            const auto& [row, value] = non_zeros[pos];
+            builder.AddNonZero(row, value);
             #ifdef DEBUG_MODE
-            A_matrix_element_debug(el);
+            A_matrix_element_debug(row, ind, value);
             #endif
         }
-
-        #ifdef DEBUG_MODE
-        cout<<"~~~~~~~~~~~~~~~~~~~~~~"<<endl;
-        #endif
     }
+    builder.Finish();
+
     #ifdef DEBUG_MODE
-    cout<<"FFO and FLO"<<endl;
+    cout << "COST_VECTOR_DEBUG and INEQUALITIES_DEBUG (A matrix)##" << endl;
     #endif
-    // for fake first order summary outgoing degree suppose to be trucks_count (its source of the graph) 
-    // but we will encode different constraint: in any given sub-graph it suppose to be 1 (its tighter one for our system)
-    // fake last order - same stands for incoming degree
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        std::vector<std::pair<size_t, int>> row_non_zeros;
-
-        // to_order_pos in [0,orders_count-1] -> real orders
-        // to_order_pos = orders_count -> fake first one
-        // to_order_pos = orders_count+1 -> fake last one
-        for (size_t to_order_pos_i = 0; to_order_pos_i < orders_count + 1 + 1; ++to_order_pos_i) {
-            size_t to_order_pos = to_order_pos_i;
-            if (to_order_pos == orders_count) {
-                to_order_pos = Solver::ffo_pos;
-            } else if (to_order_pos == orders_count + 1) {
-                to_order_pos = Solver::flo_pos;
-            }
-
-            // for fake first order we computing outcoming degree
-            auto ind_from = GetVariableIndex({truck_pos, Solver::ffo_pos, to_order_pos});
-            
-            if (ind_from.has_value()) {
-                // A[this_row][{i,j,k}] += 1
-                row_non_zeros.emplace_back(ind_from.value(), 1);
-            }
-        }
-        if (row_non_zeros.empty()) {
-            continue;
-        }
-        // not empty row => +1 row in matrix A
-        ++number_of_rows;
-
-        model.lp_.row_lower_.push_back(1);
-        model.lp_.row_upper_.push_back(1);
 
-        // setting number of non zero variables in current row of A matrix
-        A_non_zeros += row_non_zeros.size();
-        model.lp_.a_matrix_.start_.push_back(A_non_zeros);
-
-        #ifdef DEBUG_MODE
-        LU_debug(model.lp_.row_lower_.back(), model.lp_.row_upper_.back());
-        #endif
-        for (auto &el : row_non_zeros) {
-            model.lp_.a_matrix_.index_.push_back(el.first);
-            model.lp_.a_matrix_.value_.push_back(el.second);
-            #ifdef DEBUG_MODE
-            A_matrix_element_debug(el);
-            #endif
+    // rows and columns are identified by ids of trucks and orders they are made of (look HighsSession)
+    model_keys_.Clear();
+    if (options_.persistent_session) {
+        auto order_key = [&orders](size_t order_pos) {
+            return (Solver::IsFakeOrder(order_pos) ? Solver::GetFakeOrderKey(order_pos) : Solver::GetOrderKey(orders.GetOrderConst(order_pos)));
+        };
+
+        model_keys_.rows.resize(model.lp_.num_row_);
+        for (size_t pos = 0; pos < balance_keys.size(); ++pos) {
+            size_t truck_pos = balance_keys[pos] / orders_count;
+            size_t order_pos = balance_keys[pos] % orders_count;
+            uint64_t truck_key = CombineKey(1, trucks.GetTruckConst(truck_pos).truck_id);
+            model_keys_.rows[first_balance_row + pos] = CombineKey(truck_key, order_key(order_pos));
         }
-
-        #ifdef DEBUG_MODE
-        cout<<"~~~~~~~~~~~~~~~~~~~~~~"<<endl;
-        #endif
-    }
-    for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
-        std::vector<std::pair<size_t, int>> row_non_zeros;
-
-        // from_order_pos in [0,orders_count-1] -> real orders
-        // from_order_pos = orders_count -> fake first one
-        for (size_t from_order_pos_i = 0; from_order_pos_i < orders_count + 1; ++from_order_pos_i) {
-            size_t from_order_pos = from_order_pos_i;
-            if (from_order_pos == orders_count) {
-                from_order_pos = Solver::ffo_pos;
+        for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+            uint64_t truck_key = CombineKey(1, trucks.GetTruckConst(truck_pos).truck_id);
+            if (ffo_row[truck_pos] != NO_ROW) {
+                model_keys_.rows[ffo_row[truck_pos]] = CombineKey(truck_key, Solver::GetFakeOrderKey(Solver::ffo_pos));
             }
-
-            // for fake last order we computing incoming degree
-            auto ind_from = GetVariableIndex({truck_pos, from_order_pos, Solver::flo_pos});
-            
-            if (ind_from.has_value()) {
-                // A[this_row][{i,j,k}] += 1
-                row_non_zeros.emplace_back(ind_from.value(), 1);
+            if (flo_row[truck_pos] != NO_ROW) {
+                model_keys_.rows[flo_row[truck_pos]] = CombineKey(truck_key, Solver::GetFakeOrderKey(Solver::flo_pos));
             }
         }
-        if (row_non_zeros.empty()) {
-            continue;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            model_keys_.rows[first_order_row + order_pos] = CombineKey(2, order_key(order_pos));
         }
-        // not empty row => +1 row in matrix A
-        ++number_of_rows;
-
-        model.lp_.row_lower_.push_back(1);
-        model.lp_.row_upper_.push_back(1);
 
-        // setting number of non zero variables in current row of A matrix
-        A_non_zeros += row_non_zeros.size();
-        model.lp_.a_matrix_.start_.push_back(A_non_zeros);
-
-        #ifdef DEBUG_MODE
-        LU_debug(model.lp_.row_lower_.back(), model.lp_.row_upper_.back());
-        #endif
-
-        for (auto &el : row_non_zeros) {
-            model.lp_.a_matrix_.index_.push_back(el.first);
-            model.lp_.a_matrix_.value_.push_back(el.second);
-            #ifdef DEBUG_MODE
-            A_matrix_element_debug(el);
-            #endif
+        model_keys_.cols.resize(variables.size());
+        for (size_t ind = 0; ind < variables.size(); ++ind) {
+            const auto& [truck_pos, from_order_pos, to_order_pos] = variables[ind];
+            uint64_t truck_key = CombineKey(3, trucks.GetTruckConst(truck_pos).truck_id);
+            model_keys_.cols[ind] = CombineKey(CombineKey(truck_key, order_key(from_order_pos)), order_key(to_order_pos));
         }
-
-        #ifdef DEBUG_MODE
-        cout<<"~~~~~~~~~~~~~~~~~~~~~~"<<endl;
-        #endif
     }
 
     #ifdef DEBUG_MODE
-    cout << "##INEQUALITIES_DEBUG (A matrix)" << endl;
-    #endif
-
-    // number of rows in A,L,U
-    model.lp_.num_row_ = number_of_rows;
-
-    #ifdef DEBUG_MODE
-    cout << "number of rows in A: " << number_of_rows << endl
-        << "number of non zeros variables in A: " << A_non_zeros << endl;
+    cout << "number of rows in A: " << model.lp_.num_row_ << endl
+        << "number of non zeros variables in A: " << builder.GetNonZerosCount() << endl;
     #endif
     
     return model;
@@ -528,6 +513,10 @@ solution_t FlowSolver::Solve(HighsModel& model) {
     cout << "orders_count = " << orders_count << endl;
     #endif
 
+    // for classes of several trucks: first orders of their paths and next order after each picked order (look CreateModel)
+    std::vector<std::vector<size_t>> class_first_orders(truck_classes_.size());
+    std::vector<size_t> next_order(orders_count, Solver::flo_pos);
+
     for(size_t var : setted_columns) {
         auto& [i, j, k] = to_3d_variables[var];
 
@@ -553,13 +542,37 @@ solution_t FlowSolver::Solve(HighsModel& model) {
         printf("\n");
         #endif
 
+        if (truck_classes_[class_by_truck_pos_[i]].size() > 1) {
+            if (j < orders_count) {
+                next_order[j] = k;
+            } else if (k < orders_count) {
+                class_first_orders[class_by_truck_pos_[i]].push_back(k);
+            }
+            continue;
+        }
+
         // not adding fake orders in solution
         if (j < orders_count)
             orders_by_truck_pos[i].push_back(j);
     }
 
-    size_t trucks_count = data_.trucks.Size();
     const Orders& orders = data_.orders;
+    // decomposing flow of class into paths (orders cant be shared by paths) - one path for each of first trucks of class
+    for (size_t truck_class = 0; truck_class < truck_classes_.size(); ++truck_class) {
+        std::vector<size_t>& first_orders = class_first_orders[truck_class];
+        assert(first_orders.size() <= truck_classes_[truck_class].size());
+        sort(first_orders.begin(), first_orders.end(), [&orders](size_t a, size_t b) {
+            return std::make_pair(orders.GetOrderConst(a).start_time, a) < std::make_pair(orders.GetOrderConst(b).start_time, b);
+        });
+        for (size_t path = 0; path < first_orders.size(); ++path) {
+            std::vector<size_t>& scheduled_orders = orders_by_truck_pos[truck_classes_[truck_class][path]];
+            for (size_t order_pos = first_orders[path]; order_pos != Solver::flo_pos; order_pos = next_order[order_pos]) {
+                scheduled_orders.push_back(order_pos);
+            }
+        }
+    }
+
+    size_t trucks_count = data_.trucks.Size();
     for(size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
         auto &scheduled_orders = orders_by_truck_pos[truck_pos];
 
@@ -573,7 +586,7 @@ solution_t FlowSolver::Solve(HighsModel& model) {
     cout << "FLOW_SOLVER_DEBUG##" << endl;
     #endif
 
-    return {orders_by_truck_pos};
+    return {orders_by_truck_pos, last_solve_stats_.status};
 }
 
 
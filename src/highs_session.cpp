@@ -0,0 +1,241 @@
+#include "highs_session.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <unordered_set>
+
+void ModelKeys::Clear() {
+    rows.clear();
+    cols.clear();
+}
+
+Highs& HighsSession::GetHighs() {
+    return highs_;
+}
+
+void HighsSession::MakeIntegral() {
+    std::vector<HighsVarType> integrality(highs_.getNumCol(), HighsVarType::kInteger);
+    if (!integrality.empty()) {
+        HighsStatus return_status = highs_.changeColsIntegrality(0, integrality.size() - 1, integrality.data());
+        assert(return_status==HighsStatus::kOk);
+    }
+    is_integral_ = true;
+}
+
+HighsInt HighsSession::GetColumnPos(size_t col) const {
+    return col_pos_[col];
+}
+
+HighsInt HighsSession::GetRowPos(size_t row) const {
+    return row_pos_[row];
+}
+
+bool HighsSession::IsLastUpdateIncremental() const {
+    return last_update_incremental_;
+}
+
+size_t HighsSession::GetKeptColumnsCount() const {
+    return kept_cols_count_;
+}
+
+size_t HighsSession::GetAddedColumnsCount() const {
+    return added_cols_count_;
+}
+
+void HighsSession::Pass(const HighsModel& model, const ModelKeys& keys, bool has_keys) {
+    HighsStatus return_status = highs_.passModel(model);
+    assert(return_status==HighsStatus::kOk);
+
+    has_keys_ = has_keys;
+    keys_ = (has_keys ? keys : ModelKeys());
+    col_pos_.resize(model.lp_.num_col_);
+    for (HighsInt col = 0; col < model.lp_.num_col_; ++col) {
+        col_pos_[col] = col;
+    }
+    row_pos_.resize(model.lp_.num_row_);
+    for (HighsInt row = 0; row < model.lp_.num_row_; ++row) {
+        row_pos_[row] = row;
+    }
+
+    is_empty_ = false;
+    is_integral_ = false;
+    last_update_incremental_ = false;
+    kept_cols_count_ = 0;
+    added_cols_count_ = model.lp_.num_col_;
+}
+
+static bool AreUnique(const std::vector<uint64_t>& keys) {
+    std::unordered_set<uint64_t> used;
+    used.reserve(keys.size());
+    for (uint64_t key : keys) {
+        if (!used.insert(key).second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Marks keys of 'previous' which are absent in 'current' in delete_mask
+    Returns position in 'previous' for every key of 'current' (-1 if its new)
+    Note: keys of both 'previous' and 'current' are expected to be unique
+*/
+static std::vector<HighsInt> MatchKeys(
+    const std::vector<uint64_t>& previous,
+    const std::vector<uint64_t>& current,
+    std::vector<HighsInt>& delete_mask)
+{
+    std::unordered_map<uint64_t, HighsInt> previous_pos;
+    previous_pos.reserve(previous.size());
+    for (size_t pos = 0; pos < previous.size(); ++pos) {
+        previous_pos.emplace(previous[pos], pos);
+    }
+
+    // 1 - delete (HiGHS format)
+    delete_mask.assign(previous.size(), 1);
+    std::vector<HighsInt> matched(current.size(), -1);
+    for (size_t pos = 0; pos < current.size(); ++pos) {
+        auto it = previous_pos.find(current[pos]);
+        if (it == previous_pos.end()) {
+            continue;
+        }
+        delete_mask[it->second] = 0;
+        matched[pos] = it->second;
+    }
+    return matched;
+}
+
+void HighsSession::Update(const HighsModel& model, const ModelKeys& keys) {
+    const HighsLp& lp = model.lp_;
+    assert(lp.a_matrix_.format_ == MatrixFormat::kColwise);
+
+    // clocks are cumulative - time limit is meant for one solve
+    highs_.zeroAllClocks();
+
+    // rows/columns cant be matched by keys which arent unique
+    bool has_keys = keys.rows.size() == static_cast<size_t>(lp.num_row_)
+        && keys.cols.size() == static_cast<size_t>(lp.num_col_)
+        && AreUnique(keys.rows)
+        && AreUnique(keys.cols);
+    if (is_empty_ || !has_keys_ || !has_keys) {
+        Pass(model, keys, has_keys);
+        return;
+    }
+
+    std::vector<HighsInt> delete_rows_mask;
+    std::vector<HighsInt> delete_cols_mask;
+    const std::vector<HighsInt> matched_rows = MatchKeys(keys_.rows, keys.rows, delete_rows_mask);
+    const std::vector<HighsInt> matched_cols = MatchKeys(keys_.cols, keys.cols, delete_cols_mask);
+
+    // nothing to keep - passing whole model is cheaper than deleting all columns (and drops stale basis)
+    if (std::find(delete_cols_mask.begin(), delete_cols_mask.end(), 0) == delete_cols_mask.end()) {
+        Pass(model, keys, true);
+        return;
+    }
+
+    HighsStatus return_status;
+
+    // (1) deleting - masks are being overwritten by new positions (-1 for deleted)
+    return_status = highs_.deleteCols(delete_cols_mask.data());
+    assert(return_status==HighsStatus::kOk);
+    return_status = highs_.deleteRows(delete_rows_mask.data());
+    assert(return_status==HighsStatus::kOk);
+
+    if (is_integral_) {
+        std::vector<HighsVarType> integrality(highs_.getNumCol(), HighsVarType::kContinuous);
+        if (!integrality.empty()) {
+            highs_.changeColsIntegrality(0, integrality.size() - 1, integrality.data());
+        }
+        is_integral_ = false;
+    }
+
+    // kept rows/columns are at the beginning of session model now (in same relative order)
+    const HighsInt kept_rows_count = highs_.getNumRow();
+    const HighsInt kept_cols_count = highs_.getNumCol();
+
+    // model row -> session row
+    std::vector<HighsInt>& row_pos = row_pos_;
+    row_pos.resize(lp.num_row_);
+    std::vector<uint64_t> session_row_keys(kept_rows_count);
+    std::vector<double> kept_row_lower(kept_rows_count), kept_row_upper(kept_rows_count);
+    std::vector<double> new_row_lower, new_row_upper;
+    for (HighsInt row = 0; row < lp.num_row_; ++row) {
+        if (matched_rows[row] != -1) {
+            row_pos[row] = delete_rows_mask[matched_rows[row]];
+            kept_row_lower[row_pos[row]] = lp.row_lower_[row];
+            kept_row_upper[row_pos[row]] = lp.row_upper_[row];
+            session_row_keys[row_pos[row]] = keys.rows[row];
+        } else {
+            row_pos[row] = kept_rows_count + new_row_lower.size();
+            new_row_lower.push_back(lp.row_lower_[row]);
+            new_row_upper.push_back(lp.row_upper_[row]);
+            session_row_keys.push_back(keys.rows[row]);
+        }
+    }
+
+    // (2) changing kept part
+    if (kept_rows_count > 0) {
+        return_status = highs_.changeRowsBounds(0, kept_rows_count - 1, kept_row_lower.data(), kept_row_upper.data());
+        assert(return_status==HighsStatus::kOk);
+    }
+
+    col_pos_.resize(lp.num_col_);
+    std::vector<uint64_t> session_col_keys(kept_cols_count);
+    std::vector<double> kept_cost(kept_cols_count), kept_lower(kept_cols_count), kept_upper(kept_cols_count);
+
+    std::vector<double> new_cost, new_lower, new_upper;
+    std::vector<HighsInt> new_start, new_index;
+    std::vector<double> new_value;
+    for (HighsInt col = 0; col < lp.num_col_; ++col) {
+        if (matched_cols[col] != -1) {
+            HighsInt pos = delete_cols_mask[matched_cols[col]];
+            col_pos_[col] = pos;
+            kept_cost[pos] = lp.col_cost_[col];
+            kept_lower[pos] = lp.col_lower_[col];
+            kept_upper[pos] = lp.col_upper_[col];
+            session_col_keys[pos] = keys.cols[col];
+            continue;
+        }
+
+        col_pos_[col] = kept_cols_count + new_cost.size();
+        new_cost.push_back(lp.col_cost_[col]);
+        new_lower.push_back(lp.col_lower_[col]);
+        new_upper.push_back(lp.col_upper_[col]);
+        new_start.push_back(new_index.size());
+        for (HighsInt el = lp.a_matrix_.start_[col]; el < lp.a_matrix_.start_[col + 1]; ++el) {
+            new_index.push_back(row_pos[lp.a_matrix_.index_[el]]);
+            new_value.push_back(lp.a_matrix_.value_[el]);
+        }
+        session_col_keys.push_back(keys.cols[col]);
+    }
+
+    if (kept_cols_count > 0) {
+        return_status = highs_.changeColsCost(0, kept_cols_count - 1, kept_cost.data());
+        assert(return_status==HighsStatus::kOk);
+        return_status = highs_.changeColsBounds(0, kept_cols_count - 1, kept_lower.data(), kept_upper.data());
+        assert(return_status==HighsStatus::kOk);
+    }
+    highs_.changeObjectiveSense(lp.sense_);
+    highs_.changeObjectiveOffset(lp.offset_);
+
+    // (3) adding new rows (without coefficients - kept columns dont have them by key definition) and new columns
+    if (!new_row_lower.empty()) {
+        return_status = highs_.addRows(new_row_lower.size(), new_row_lower.data(), new_row_upper.data(), 0, nullptr, nullptr, nullptr);
+        assert(return_status==HighsStatus::kOk);
+    }
+    if (!new_cost.empty()) {
+        return_status = highs_.addCols(
+            new_cost.size(), new_cost.data(), new_lower.data(), new_upper.data(),
+            new_index.size(), new_start.data(), new_index.data(), new_value.data()
+        );
+        assert(return_status==HighsStatus::kOk);
+    }
+
+    keys_.rows = std::move(session_row_keys);
+    keys_.cols = std::move(session_col_keys);
+
+    last_update_incremental_ = true;
+    kept_cols_count_ = kept_cols_count;
+    added_cols_count_ = new_cost.size();
+}
@@ -0,0 +1,211 @@
+#include "lagrangian_flow_solver.h"
+#include "longest_path_finder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace {
+    constexpr double FORBIDDEN = LongestPathFinder::FORBIDDEN;
+}
+
+//////////////////////////
+// LagrangianFlowSolver //
+//////////////////////////
+
+LagrangianFlowSolver::LagrangianFlowSolver(size_t max_iterations, const SolverOptions& options)
+    : Solver(options), max_iterations_(max_iterations), flow_solver(options) {}
+
+void LagrangianFlowSolver::SetOptions(const SolverOptions& options) {
+    Solver::SetOptions(options);
+    flow_solver.SetOptions(options);
+}
+
+void LagrangianFlowSolver::SetData(const Data& data) {
+    data_ = data;
+}
+
+const Data& LagrangianFlowSolver::GetDataConst() const {
+    return data_;
+}
+
+HighsModel LagrangianFlowSolver::CreateModel() {
+    flow_solver.SetData(data_);
+    return flow_solver.CreateModel();
+}
+
+solution_t LagrangianFlowSolver::Solve() {
+    // every 'repair_period' iterations relaxed paths are being turned into schedule
+    static constexpr size_t repair_period = 10;
+    // iterations without improvement of dual bound before step is being halved
+    static constexpr size_t patience = 20;
+
+    auto start = std::chrono::steady_clock::now();
+    last_solve_stats_ = SolveStats();
+
+    const Trucks& trucks = data_.trucks;
+    const Orders& orders = data_.orders;
+    size_t trucks_count = trucks.Size();
+    size_t orders_count = orders.Size();
+
+    // Note: indexes are lazy - building them before threads start
+    const LongestPathFinder finder(data_);
+
+    const size_t threads_count = ResolveThreadsCount(options_.prepare_threads, trucks_count);
+    std::vector<LongestPathFinder::Scratch> scratches(threads_count);
+
+    // bonus of obligation orders while repairing (revenues of all orders together) - they are being taken first
+    double obligation_bonus = 1.;
+    for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+        obligation_bonus += std::abs(data_.GetRealOrderRevenue(order_pos));
+    }
+
+    // penalty of order (multiplier of its condition 2 row): >= 0 for "at most once", any for obligation "exactly once"
+    std::vector<double> penalties(orders_count, 0.);
+    std::vector<LongestPathFinder::Path> paths(trucks_count);
+    std::vector<std::vector<size_t>> schedule(trucks_count);
+    bool has_schedule = false;
+    double primal_bound = 0.;
+
+    /*
+        Trucks one by one (best reduced revenue first) take the longest path over orders which are not taken yet
+        revenue of orders is being decreased by 'order_penalties' (only for choosing paths, schedule gets real revenue)
+        Note: schedule which left some obligation order is being thrown away
+    */
+    auto repair = [&](const std::vector<double>& order_penalties) {
+        std::vector<size_t> trucks_order(trucks_count);
+        std::iota(trucks_order.begin(), trucks_order.end(), 0);
+        std::stable_sort(trucks_order.begin(), trucks_order.end(), [&paths](size_t a, size_t b) {
+            return paths[a].revenue > paths[b].revenue;
+        });
+
+        std::vector<double> penalties = order_penalties;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            if (orders.GetOrderConst(order_pos).obligation) {
+                penalties[order_pos] -= obligation_bonus;
+            }
+        }
+
+        std::vector<std::vector<size_t>> repaired(trucks_count);
+        double revenue = 0.;
+        for (size_t truck_pos : trucks_order) {
+            LongestPathFinder::Path path = finder.Find(truck_pos, penalties, 0, scratches[0]);
+            revenue += path.revenue;
+            for (size_t order_pos : path.orders) {
+                revenue += penalties[order_pos];
+                penalties[order_pos] = FORBIDDEN;
+            }
+            repaired[truck_pos] = std::move(path.orders);
+        }
+
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            if (orders.GetOrderConst(order_pos).obligation && penalties[order_pos] != FORBIDDEN) {
+                return;
+            }
+        }
+        if (!has_schedule || revenue > primal_bound) {
+            has_schedule = true;
+            primal_bound = revenue;
+            schedule = std::move(repaired);
+        }
+    };
+
+    const std::vector<double> zero_penalties(orders_count, 0.);
+    std::vector<double> subgradient(orders_count);
+    std::vector<size_t> picked(orders_count);
+    double dual_bound = FORBIDDEN;
+    double step_scale = 2.;
+    size_t iterations_without_improvement = 0;
+
+    size_t iteration = 0;
+    while (iteration < max_iterations_) {
+        ParallelForEach(threads_count, trucks_count, [&](size_t truck_pos, size_t thread) {
+            paths[truck_pos] = finder.Find(truck_pos, penalties, 0, scratches[thread]);
+        });
+        ++iteration;
+
+        // value of relaxation: sum of paths + penalties of rows with right side 1
+        double value = std::accumulate(penalties.begin(), penalties.end(), 0.);
+        std::fill(picked.begin(), picked.end(), 0);
+        for (const LongestPathFinder::Path& path : paths) {
+            value += path.revenue;
+            for (size_t order_pos : path.orders) {
+                ++picked[order_pos];
+            }
+        }
+
+        // only components which can move penalties (zero penalty cant go lower for "at most once" rows)
+        double norm = 0.;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            double g = 1. - picked[order_pos];
+            if (!orders.GetOrderConst(order_pos).obligation && penalties[order_pos] == 0. && g > 0.) {
+                g = 0.;
+            }
+            subgradient[order_pos] = g;
+            norm += g * g;
+        }
+
+        if (value < dual_bound) {
+            dual_bound = value;
+            iterations_without_improvement = 0;
+        } else if (++iterations_without_improvement >= patience) {
+            step_scale /= 2.;
+            iterations_without_improvement = 0;
+        }
+
+        if (norm == 0.) {
+            // paths dont share orders and cover obligations - they are optimal schedule (value of relaxation is reached)
+            has_schedule = true;
+            primal_bound = 0.;
+            for (size_t truck_pos = 0; truck_pos < trucks_count; ++truck_pos) {
+                schedule[truck_pos] = paths[truck_pos].orders;
+                primal_bound += paths[truck_pos].revenue;
+                for (size_t order_pos : paths[truck_pos].orders) {
+                    primal_bound += penalties[order_pos];
+                }
+            }
+            dual_bound = std::min(dual_bound, primal_bound);
+            break;
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool is_last = (iteration == max_iterations_ || elapsed >= options_.time_limit);
+        if ((iteration - 1) % repair_period == 0 || is_last) {
+            repair(zero_penalties);
+            repair(penalties);
+        }
+        if (is_last || (has_schedule && dual_bound - primal_bound <= options_.mip_rel_gap * std::max(1., std::abs(dual_bound)))) {
+            break;
+        }
+
+        // Polyak step towards best schedule (or a bit below relaxation value while there is none)
+        double target = (has_schedule ? primal_bound : std::min(0., value) - 1.);
+        double step = step_scale * std::max(value - target, 0.) / norm;
+        for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+            penalties[order_pos] -= step * subgradient[order_pos];
+            if (!orders.GetOrderConst(order_pos).obligation) {
+                penalties[order_pos] = std::max(0., penalties[order_pos]);
+            }
+        }
+    }
+
+    last_solve_stats_.iterations = iteration;
+    last_solve_stats_.primal_bound = primal_bound;
+    last_solve_stats_.dual_bound = dual_bound;
+    last_solve_stats_.lp_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double gap = (dual_bound - primal_bound) / std::max(1., std::abs(dual_bound));
+    if (!has_schedule) {
+        last_solve_stats_.status = SOLUTION_STATUS::NO_SOLUTION;
+    } else if (gap > options_.mip_rel_gap) {
+        last_solve_stats_.status = SOLUTION_STATUS::INCUMBENT;
+    }
+
+    #ifdef DEBUG_MODE
+    std::cout << "Lagrangian relaxation: " << iteration << " iterations, " << last_solve_stats_.lp_time << "s"
+        << ", primal " << primal_bound << ", dual " << dual_bound << ", gap " << gap << std::endl;
+    #endif
+
+    return {schedule, last_solve_stats_.status};
+}
@@ -0,0 +1,98 @@
+#include "longest_path_finder.h"
+#include "solver.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    constexpr double NO_PATH = -std::numeric_limits<double>::infinity();
+    constexpr size_t NO_PARENT = static_cast<size_t>(-1);
+}
+
+LongestPathFinder::LongestPathFinder(const Data& data) :
+    compatibility_(data.GetCompatibility()),
+    successors_(data.GetSuccessors())
+{
+    const Trucks& trucks = data.trucks;
+    const Orders& orders = data.orders;
+
+    const std::vector<uint32_t>& by_start_time = successors_.GetOrdersByStartTime();
+    rank_.resize(by_start_time.size());
+    for (size_t rank = 0; rank < by_start_time.size(); ++rank) {
+        rank_[by_start_time[rank]] = rank;
+    }
+
+    first_orders_.resize(trucks.Size());
+    for (size_t truck_pos = 0; truck_pos < trucks.Size(); ++truck_pos) {
+        Order ffo = Solver::make_ffo(trucks.GetTruckConst(truck_pos));
+        compatibility_.ForEachExecutableOrder(truck_pos, [&](size_t order_pos) {
+            if (auto move_revenue = data.MoveBetweenOrders(ffo, orders.GetOrderConst(order_pos))) {
+                first_orders_[truck_pos].push_back({order_pos, move_revenue.value()});
+            }
+        });
+    }
+}
+
+LongestPathFinder::Path LongestPathFinder::Find(size_t truck_pos, const std::vector<double>& penalties, size_t max_len, Scratch& scratch,
+    const std::vector<double>* end_revenues, double empty_revenue) const
+{
+    const std::vector<uint32_t>& by_start_time = successors_.GetOrdersByStartTime();
+    const size_t orders_count = by_start_time.size();
+
+    // without limit (or with limit which cant be reached) one layer is enough
+    const bool limited = (max_len > 0 && max_len < orders_count);
+    const size_t layers_count = (limited ? max_len : 1);
+
+    // revenue[layer * orders_count + order_pos] - best path which ends by order (and has layer + 1 orders if limited)
+    std::vector<double>& revenue = scratch.revenue;
+    std::vector<size_t>& parent = scratch.parent;
+    revenue.assign(layers_count * orders_count, NO_PATH);
+    parent.resize(layers_count * orders_count);
+
+    for (const auto& [order_pos, move_revenue] : first_orders_[truck_pos]) {
+        revenue[order_pos] = move_revenue - penalties[order_pos];
+        parent[order_pos] = NO_PARENT;
+    }
+
+    Path path;
+    path.revenue = empty_revenue;
+    size_t last = NO_PARENT;
+    for (size_t layer = 0; layer < layers_count; ++layer) {
+        const size_t offset = layer * orders_count;
+        const bool can_grow = (!limited || layer + 1 < layers_count);
+        const size_t next_offset = (limited ? offset + orders_count : offset);
+
+        for (size_t from_order_pos : by_start_time) {
+            double from_revenue = revenue[offset + from_order_pos];
+            if (from_revenue == NO_PATH) {
+                continue;
+            }
+            double end_revenue = from_revenue + (end_revenues ? (*end_revenues)[from_order_pos] : 0.);
+            if (end_revenue > path.revenue) {
+                path.revenue = end_revenue;
+                last = offset + from_order_pos;
+            }
+            if (!can_grow) {
+                continue;
+            }
+
+            uint32_t from_rank = rank_[from_order_pos];
+            successors_.ForEachSuccessor(from_order_pos, [&](size_t to_order_pos, double move_revenue) {
+                if (rank_[to_order_pos] <= from_rank || !compatibility_.IsExecutable(truck_pos, to_order_pos)) {
+                    return;
+                }
+                double to_revenue = from_revenue + move_revenue - penalties[to_order_pos];
+                if (to_revenue > revenue[next_offset + to_order_pos]) {
+                    revenue[next_offset + to_order_pos] = to_revenue;
+                    parent[next_offset + to_order_pos] = offset + from_order_pos;
+                }
+            });
+        }
+    }
+
+    for (size_t node = last; node != NO_PARENT; node = parent[node]) {
+        path.orders.push_back(node % orders_count);
+    }
+    std::reverse(path.orders.begin(), path.orders.end());
+    return path;
+}
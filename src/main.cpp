@@ -4,6 +4,7 @@
 #include "flow_solver.h"
 #include "weighted_cities_solver.h"
 #include "batch_solver.h"
+#include "data_snapshot.h"
 
 #include <cassert>
 
@@ -49,8 +50,18 @@ int main() {
     std::string trucks_path = "./../samples/trucks.xlsx";
     std::string orders_path = "./../samples/orders.xlsx";
     std::string dists_path = "./../samples/distances.xlsx";
-    
-    Data data(params_path, trucks_path, orders_path, dists_path);
+    std::string snapshot_path = "./../samples/data.snapshot";
+
+    // parsing .xlsx only if there is no up-to-date snapshot of same inputs
+    uint64_t fingerprint = DataSnapshot::Fingerprint({params_path, trucks_path, orders_path, dists_path});
+    std::optional<Data> snapshot = DataSnapshot::Read(snapshot_path, fingerprint);
+    if (!snapshot.has_value()) {
+        snapshot = Data(params_path, trucks_path, orders_path, dists_path);
+        if (!DataSnapshot::Write(snapshot.value(), snapshot_path, fingerprint)) {
+            std::cerr << "Snapshot " << snapshot_path << " wasnt written - next run will parse .xlsx again" << std::endl;
+        }
+    }
+    Data data(std::move(snapshot.value()));
 
     constexpr unsigned int time_window = 1*24*60;
 
@@ -69,7 +80,7 @@ int main() {
     // data.params.DebugPrint();
     // data.trucks.DebugPrint();
     // data.orders.DebugPrint();
-    // data.dists.DebugPrint();
+    // data.GetDistsRef().DebugPrint();
 
     for (Order &order : data.orders) {
         order.obligation = 0;
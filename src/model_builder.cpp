@@ -0,0 +1,65 @@
+#include "model_builder.h"
+
+ColumnwiseModelBuilder::ColumnwiseModelBuilder(HighsModel& model, ObjSense sense) :
+    model_(model),
+    start_(model.lp_.a_matrix_.start_),
+    index_(model.lp_.a_matrix_.index_),
+    value_(model.lp_.a_matrix_.value_)
+{
+    model_.lp_.sense_ = sense;
+    model_.lp_.offset_ = 0;
+    model_.lp_.a_matrix_.format_ = MatrixFormat::kColwise;
+}
+
+void ColumnwiseModelBuilder::ReserveRows(size_t rows_count) {
+    model_.lp_.row_lower_.reserve(rows_count);
+    model_.lp_.row_upper_.reserve(rows_count);
+}
+
+int ColumnwiseModelBuilder::AddRow(double lower, double upper) {
+    model_.lp_.row_lower_.push_back(lower);
+    model_.lp_.row_upper_.push_back(upper);
+    return model_.lp_.row_lower_.size() - 1;
+}
+
+void ColumnwiseModelBuilder::SetColumnsCount(size_t columns_count) {
+    columns_count_ = columns_count;
+    model_.lp_.num_col_ = columns_count;
+    model_.lp_.col_cost_.resize(columns_count);
+    model_.lp_.col_lower_.resize(columns_count);
+    model_.lp_.col_upper_.resize(columns_count);
+    start_.assign(columns_count + 1, 0);
+}
+
+void ColumnwiseModelBuilder::AllocateNonZeros() {
+    for (size_t col = 0; col < columns_count_; ++col) {
+        start_[col + 1] += start_[col];
+    }
+    index_.resize(start_[columns_count_]);
+    value_.resize(start_[columns_count_]);
+    cur_col_ = 0;
+    cursor_ = 0;
+}
+
+void ColumnwiseModelBuilder::SetColumn(size_t col, double cost, double lower, double upper) {
+    assert(col < columns_count_);
+    // previous column suppose to be filled completely
+    assert(col == 0 || cursor_ == static_cast<size_t>(start_[col]));
+    cur_col_ = col;
+    cursor_ = start_[col];
+
+    model_.lp_.col_cost_[col] = cost;
+    model_.lp_.col_lower_[col] = lower;
+    model_.lp_.col_upper_[col] = upper;
+}
+
+size_t ColumnwiseModelBuilder::GetNonZerosCount() const {
+    return index_.size();
+}
+
+void ColumnwiseModelBuilder::Finish() {
+    assert(columns_count_ == 0 || cursor_ == static_cast<size_t>(start_[columns_count_]));
+    model_.lp_.num_row_ = model_.lp_.row_lower_.size();
+    model_.lp_.a_matrix_.num_col_ = model_.lp_.num_col_;
+    model_.lp_.a_matrix_.num_row_ = model_.lp_.num_row_;
+}
@@ -81,18 +81,16 @@ Order::Order(
 
 
 Orders::Orders(const std::string &path_to_xlsx) {
-    XLDocument doc;
-    doc.open(path_to_xlsx);
-    auto worksheet = doc.workbook().worksheet("Sheet1");
+    TableReader reader(path_to_xlsx);
 
     bool is_need_skip_header = 1;
-    for (auto& row : worksheet.rows()) {
+    while (reader.NextRow()) {
         if(is_need_skip_header) {
             is_need_skip_header = false;
             continue;
         }
         
-        XLSXcell cell(row.cells().begin());
+        TableCell cell = reader.FirstCell();
         if(cell.get_type()==XLValueType::Empty) {
             break;
         }
@@ -144,6 +142,10 @@ Orders::Orders(const std::string &path_to_xlsx) {
             });
         }
     }
+
+    #ifdef DEBUG_MODE
+    reader.DebugPrintStats(path_to_xlsx);
+    #endif
 }
 
 Orders::Orders(const std::vector<Order>& orders): orders_(orders) {}
@@ -1,5 +1,7 @@
 #include "pre_solver.h"
 
+#include <algorithm>
+
 size_t PreSolver::GetGraphNode(size_t order_pos) const {
     bool is_fo = Solver::IsFakeOrder(order_pos);
 
@@ -10,7 +12,7 @@ size_t PreSolver::GetGraphNode(size_t order_pos) const {
     return graph_node;
 }
 
-PreSolver::PreSolver(const std::vector<variable_t>& variables) : variables_(variables) {
+PreSolver::PreSolver(const std::vector<variable_t>& variables, int threads) : variables_(variables) {
     size_t vars_count = variables_.size();
     valid_vars_.resize(vars_count, 0);
 
@@ -32,85 +34,135 @@ PreSolver::PreSolver(const std::vector<variable_t>& variables) : variables_(vari
     }
     trucks_count_ = trucks_mx + 1;
     orders_count_ = orders_mx + 1;
-    
 
-    // +2 because we need to take in account ffo and flo 
-    graph_.resize(orders_count_ + 2);
-    used_.resize(orders_count_ + 2, false);
+    // bucketing variables by truck (counting sort - variables of truck keep their order)
+    truck_vars_begin_.assign(trucks_count_ + 1, 0);
+    for (const auto& [truck_pos, from_order_pos, to_order_pos] : variables_) {
+        ++truck_vars_begin_[truck_pos + 1];
+    }
+    for (size_t truck_pos = 0; truck_pos < trucks_count_; ++truck_pos) {
+        truck_vars_begin_[truck_pos + 1] += truck_vars_begin_[truck_pos];
+    }
+    vars_by_truck_.resize(vars_count);
+    {
+        std::vector<size_t> next_pos(truck_vars_begin_.begin(), truck_vars_begin_.end() - 1);
+        for (size_t var_index = 0; var_index < vars_count; ++var_index) {
+            vars_by_truck_[next_pos[std::get<0>(variables_[var_index])]++] = var_index;
+        }
+    }
 
-    PreSolve();
+
+    PreSolve(threads);
 }
 
-void PreSolver::MarkConnectivityComponent(size_t v) {
-    if (used_[v]) {
+void PreSolver::MarkConnectivityComponent(PreSolverScratch& scratch, size_t v) {
+    auto& graph = scratch.graph;
+    auto& used = scratch.used;
+    auto& stack = scratch.stack;
+
+    if (used[v]) {
         return;
     }
-    used_[v] = 1;
-    for (auto& to_node : graph_[v]) {
-        ++valid_vars_[to_node.var_index];
-        MarkConnectivityComponent(to_node.to);
+    used[v] = true;
+    // 'v' might have no edges of current truck so ClearGraph wouldnt know about it otherwise
+    scratch.graph_nodes.push_back(v);
+    stack.push_back(v);
+    while (!stack.empty()) {
+        size_t cur = stack.back();
+        stack.pop_back();
+        for (const PreSolverNode& to_node : graph[cur]) {
+            ++valid_vars_[to_node.var_index];
+            if (!used[to_node.to]) {
+                used[to_node.to] = true;
+                stack.push_back(to_node.to);
+            }
+        }
     }
 }
 
-void PreSolver::ClearGraph() {
-    for (auto &arr : graph_) {
-        arr.clear();
+void PreSolver::ClearGraph(PreSolverScratch& scratch) const {
+    for (size_t node : scratch.graph_nodes) {
+        scratch.graph[node].clear();
+        scratch.used[node] = false;
     }
-    std::fill(used_.begin(), used_.end(), false);
+    scratch.graph_nodes.clear();
 }
 
-void PreSolver::PreSolve() {
-    for (size_t cur_truck_pos = 0; cur_truck_pos < trucks_count_; ++cur_truck_pos) {
+void PreSolver::PreSolveTrucks(size_t first_truck_pos, size_t last_truck_pos, PreSolverScratch& scratch) {
+    // +2 because we need to take in account ffo and flo 
+    scratch.graph.resize(orders_count_ + 2);
+    scratch.used.resize(orders_count_ + 2, false);
+
+    auto add_edge = [&scratch](size_t from, size_t to, size_t var_index) {
+        if (scratch.graph[from].empty()) {
+            scratch.graph_nodes.push_back(from);
+        }
+        scratch.graph_nodes.push_back(to);
+        scratch.graph[from].push_back(PreSolverNode{to, var_index});
+    };
+
+    for (size_t cur_truck_pos = first_truck_pos; cur_truck_pos < last_truck_pos; ++cur_truck_pos) {
+        const size_t first = truck_vars_begin_[cur_truck_pos];
+        const size_t last = truck_vars_begin_[cur_truck_pos + 1];
+
         // marking source component
         {
-            for (size_t var_index = 0; var_index < variables_.size(); ++var_index) {
+            for (size_t i = first; i < last; ++i) {
+                size_t var_index = vars_by_truck_[i];
                 const auto& [truck_pos, from_order_pos, to_order_pos] = variables_[var_index];
-                if (cur_truck_pos != truck_pos) {
-                    continue;
-                }
 
                 // not taking in account edges leading to sink
-                graph_[GetGraphNode(from_order_pos)].push_back(PreSolverNode{
-                    GetGraphNode(to_order_pos),  // to
-                    var_index
-                });
+                add_edge(GetGraphNode(from_order_pos), GetGraphNode(to_order_pos), var_index);
             }
 
-            MarkConnectivityComponent(GetGraphNode(Solver::ffo_pos));
+            MarkConnectivityComponent(scratch, GetGraphNode(Solver::ffo_pos));
 
-            ClearGraph();
+            ClearGraph(scratch);
         }
         // marking sink component
         {
-            for (size_t var_index = 0; var_index < variables_.size(); ++var_index) {
+            for (size_t i = first; i < last; ++i) {
+                size_t var_index = vars_by_truck_[i];
                 const auto& [truck_pos, from_order_pos, to_order_pos] = variables_[var_index];
-                if (cur_truck_pos != truck_pos) {
-                    continue;
-                }
 
                 // not taking in account edges leading to source
-                graph_[GetGraphNode(to_order_pos)].push_back(PreSolverNode{
-                    GetGraphNode(from_order_pos),  // to
-                    var_index
-                });
+                add_edge(GetGraphNode(to_order_pos), GetGraphNode(from_order_pos), var_index);
             }
 
-            MarkConnectivityComponent(GetGraphNode(Solver::flo_pos));
+            MarkConnectivityComponent(scratch, GetGraphNode(Solver::flo_pos));
 
-            ClearGraph();
+            ClearGraph(scratch);
         }
     }
+}
+
+void PreSolver::PreSolve(int threads) {
+    size_t threads_count = ResolveThreadsCount(threads, trucks_count_);
+
+    // contiguous ranges of trucks with about same count of variables
+    std::vector<size_t> first_truck_pos(threads_count + 1, trucks_count_);
+    first_truck_pos[0] = 0;
+    for (size_t thread = 1; thread < threads_count; ++thread) {
+        size_t vars_bound = variables_.size() * thread / threads_count;
+        first_truck_pos[thread] = std::lower_bound(truck_vars_begin_.begin(), truck_vars_begin_.end() - 1, vars_bound) - truck_vars_begin_.begin();
+        first_truck_pos[thread] = std::max(first_truck_pos[thread], first_truck_pos[thread - 1]);
+    }
 
-    std::vector<variable_t> filtered_variables;
-    filtered_variables.reserve(variables_.size());
+    std::vector<PreSolverScratch> scratches(threads_count);
+    ParallelFor(threads_count, [&](size_t thread) {
+        PreSolveTrucks(first_truck_pos[thread], first_truck_pos[thread + 1], scratches[thread]);
+    });
+
+    // compacting survivors in place (keeping their order)
+    size_t filtered_count = 0;
     for (size_t var_index = 0; var_index < variables_.size(); ++var_index) {
         if (valid_vars_[var_index] == 2) {
-            filtered_variables.emplace_back(std::move(variables_[var_index]));
+            variables_[filtered_count++] = variables_[var_index];
         }
     }
-    variables_ = filtered_variables;
+    variables_.resize(filtered_count);
 }
 
 std::vector<variable_t> PreSolver::GetFilteredVariables() const {
     return variables_;
-}
\ No newline at end of file
+}
@@ -1,10 +1,16 @@
 #include "solver.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
 ////////////////////////////////
 // FreeMovementWeightsVectors //
 ////////////////////////////////
 
-std::pair<Orders, std::unordered_map<std::tuple<size_t, size_t, unsigned int>, size_t>> FreeMovementWeightsVectors::GetFreeMovementEdges(const Data& data) const {
+std::pair<Orders, std::vector<size_t>> FreeMovementWeightsVectors::GetFreeMovementEdges(const Data& data) const {
     static auto AddFreeMovementEdge = [](
         Orders& orders,
         const Params& params,
@@ -57,66 +63,73 @@ std::pair<Orders, std::unordered_map<std::tuple<size_t, size_t, unsigned int>, s
         orders.AddOrder(new_order);
     };
 
+    Sort();
+
     // will return this orders and mapping
     Orders dop_orders;
-    std::unordered_map<std::tuple<size_t, size_t, unsigned int>, size_t> edge_to_pos;
+    std::vector<size_t> edge_to_pos(weights_.size());
 
     const Orders& orders = data.orders;
     const Params& params = data.params;
     const Trucks& trucks = data.trucks;
-    const Distances& dists  = data.dists;
+    const Distances& dists  = data.GetDistsConst();
+
+    // {from_city, to_city, start_time} of free-movement edge of each weight
+    std::vector<std::tuple<unsigned int, unsigned int, unsigned int>> edge_keys(weights_.size());
+    for (size_t weight_pos = 0; weight_pos < weights_.size(); ++weight_pos) {
+        const auto& [truck_pos, order_pos, to_city, _] = weights_[weight_pos];
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+        if (order_pos == Solver::ffo_pos) {
+            edge_keys[weight_pos] = {truck.init_city, to_city, truck.init_time};
+        } else {
+            const Order& order = orders.GetOrderConst(order_pos);
+            edge_keys[weight_pos] = {order.to_city, to_city, order.finish_time};
+        }
+    }
 
     /* 
         There is no point to add free-movement edges twice
         also each free-movement edge can be identified by {from_city, to_city, start_time}
 
-        Additionally store position of free-movement edge in orders set
+        Edge is being made by first weight with its key (others are pointed to it) 
     */
-    std::unordered_map<std::tuple<unsigned int, unsigned int, unsigned int>, size_t> used;
-
-    for (const auto& [gkey, vec] : *this) {
-        const auto& [truck_pos, order_pos] = gkey;
-
-        for(const auto& [to_city, revenue_bonus] : vec) {
-            unsigned int from_city;
-            unsigned int start_time;
-
-            const Truck& truck = trucks.GetTruckConst(truck_pos);
-            if (order_pos == Solver::ffo_pos) {
-                from_city = truck.init_city;
-                start_time = truck.init_time;
-            } else {
-                const Order& order = orders.GetOrderConst(order_pos);
-                from_city = order.to_city;
-                start_time = order.finish_time;
-            }
-            
-            std::tuple<unsigned int, unsigned int, unsigned int> tuple_key = {from_city, to_city, start_time};
-            // checking if we already tried to add this edge
-            {
-                auto it = used.find(tuple_key);
-                if (it != used.end()) {
-                    edge_to_pos[{truck_pos, order_pos, to_city}] = it->second;
-                    continue;
-                }
-            }
+    std::vector<size_t> by_edge_key(weights_.size());
+    std::iota(by_edge_key.begin(), by_edge_key.end(), 0);
+    std::stable_sort(by_edge_key.begin(), by_edge_key.end(), [&edge_keys](size_t a, size_t b) {
+        return edge_keys[a] < edge_keys[b];
+    });
+    std::vector<size_t> first_with_key(weights_.size());
+    for (size_t i = 0; i < by_edge_key.size(); ++i) {
+        bool same_key = (i > 0 && edge_keys[by_edge_key[i]] == edge_keys[by_edge_key[i - 1]]);
+        first_with_key[by_edge_key[i]] = (same_key ? first_with_key[by_edge_key[i - 1]] : by_edge_key[i]);
+    }
 
-            // made for performance boost purposes - making free-movement edge pickable only by truck with 'truck_pos'
-            int mask_load_type = truck.mask_load_type + truck_pos * (1 << LOAD_TYPE_COUNT);
-            AddFreeMovementEdge(
-                dop_orders,
-                params,
-                dists,
-                from_city,
-                to_city,
-                start_time,
-                mask_load_type,
-                truck.mask_trailer_type,
-                revenue_bonus
-            );
-
-            edge_to_pos[{truck_pos, order_pos, to_city}] = used[tuple_key] = dop_orders.Size() - 1;
+    for (size_t weight_pos = 0; weight_pos < weights_.size(); ++weight_pos) {
+        // checking if we already added this edge
+        if (first_with_key[weight_pos] != weight_pos) {
+            edge_to_pos[weight_pos] = edge_to_pos[first_with_key[weight_pos]];
+            continue;
         }
+
+        const auto& [truck_pos, order_pos, to_city, revenue_bonus] = weights_[weight_pos];
+        const auto& [from_city, _, start_time] = edge_keys[weight_pos];
+        const Truck& truck = trucks.GetTruckConst(truck_pos);
+
+        // made for performance boost purposes - making free-movement edge pickable only by truck with 'truck_pos'
+        int mask_load_type = truck.mask_load_type + truck_pos * (1 << LOAD_TYPE_COUNT);
+        AddFreeMovementEdge(
+            dop_orders,
+            params,
+            dists,
+            from_city,
+            to_city,
+            start_time,
+            mask_load_type,
+            truck.mask_trailer_type,
+            revenue_bonus
+        );
+
+        edge_to_pos[weight_pos] = dop_orders.Size() - 1;
     }
 
     return {dop_orders, edge_to_pos};
@@ -124,60 +137,123 @@ std::pair<Orders, std::unordered_map<std::tuple<size_t, size_t, unsigned int>, s
 
 FreeMovementWeightsVectors::FreeMovementWeightsVectors() {};
 
-FreeMovementWeightsVectors::FreeMovementWeightsVectors(const FreeMovementWeightsVectors& other): edges_w_vecs_(other.edges_w_vecs_) {}
+FreeMovementWeightsVectors::FreeMovementWeightsVectors(const FreeMovementWeightsVectors& other):
+    weights_(other.weights_),
+    ranges_(other.ranges_),
+    truck_ranges_(other.truck_ranges_),
+    unsorted_count_(other.unsorted_count_) {}
 
 const FreeMovementWeightsVectors& FreeMovementWeightsVectors::operator=(const FreeMovementWeightsVectors& other) {
-    edges_w_vecs_ = other.edges_w_vecs_;
+    weights_ = other.weights_;
+    ranges_ = other.ranges_;
+    truck_ranges_ = other.truck_ranges_;
+    unsorted_count_ = other.unsorted_count_;
     return *this;
 }
 
-bool FreeMovementWeightsVectors::IsInitialized() const {
-    return !edges_w_vecs_.empty();
+std::vector<FreeMovementWeight>::const_iterator FreeMovementWeightsVectors::begin() const {  // NOLINT
+    Sort();
+    return weights_.begin();
 }
 
+std::vector<FreeMovementWeight>::const_iterator FreeMovementWeightsVectors::end() const {  // NOLINT
+    Sort();
+    return weights_.end();
+}
 
-std::optional<std::reference_wrapper<weights_vector_t>> FreeMovementWeightsVectors::GetWeightsVector(size_t truck_pos, size_t order_pos) {
-    auto it = edges_w_vecs_.find({truck_pos, order_pos});
-    if (it == edges_w_vecs_.end()) {
-        return std::nullopt;
+void FreeMovementWeightsVectors::Sort() const {
+    if (unsorted_count_ == 0) {
+        return;
+    }
+    unsorted_count_ = 0;
+
+    // stable - weights of same key are being summed in order they were added
+    std::stable_sort(weights_.begin(), weights_.end(), [](const FreeMovementWeight& a, const FreeMovementWeight& b) {
+        return std::tie(a.truck_pos, a.order_pos, a.city_id) < std::tie(b.truck_pos, b.order_pos, b.city_id);
+    });
+    size_t size = 0;
+    for (size_t weight_pos = 0; weight_pos < weights_.size(); ++weight_pos) {
+        const FreeMovementWeight& w = weights_[weight_pos];
+        if (size > 0) {
+            FreeMovementWeight& prev = weights_[size - 1];
+            if (prev.truck_pos == w.truck_pos && prev.order_pos == w.order_pos && prev.city_id == w.city_id) {
+                prev.weight += w.weight;
+                continue;
+            }
+        }
+        weights_[size++] = w;
+    }
+    weights_.resize(size);
+
+    ranges_.clear();
+    size_t trucks_count = (weights_.empty() ? 0 : weights_.back().truck_pos + 1);
+    truck_ranges_.assign(trucks_count + 1, 0);
+    for (size_t weight_pos = 0; weight_pos < weights_.size(); ++weight_pos) {
+        const FreeMovementWeight& w = weights_[weight_pos];
+        if (weight_pos == 0 || weights_[weight_pos - 1].truck_pos != w.truck_pos || weights_[weight_pos - 1].order_pos != w.order_pos) {
+            ranges_.push_back({w.order_pos, FreeMovementWeightsRange{weight_pos, weight_pos}});
+            ++truck_ranges_[w.truck_pos + 1];
+        }
+        ++ranges_.back().second.last;
     }
-    return std::optional(std::ref(it->second));
+    std::partial_sum(truck_ranges_.begin(), truck_ranges_.end(), truck_ranges_.begin());
 }
 
-std::optional<std::reference_wrapper<const weights_vector_t>> FreeMovementWeightsVectors::GetWeightsVectorConst(size_t truck_pos, size_t order_pos) const {
-    auto it = edges_w_vecs_.find({truck_pos, order_pos});
-    if (it == edges_w_vecs_.end()) {
-        return std::nullopt;
+bool FreeMovementWeightsVectors::IsInitialized() const {
+    return !weights_.empty();
+}
+
+FreeMovementWeightsRange FreeMovementWeightsVectors::GetWeightsVectorConst(size_t truck_pos, size_t order_pos) const {
+    Sort();
+    if (truck_pos + 1 >= truck_ranges_.size()) {
+        return {};
     }
-    return std::optional(std::cref(it->second));
+
+    auto first = ranges_.begin() + truck_ranges_[truck_pos];
+    auto last = ranges_.begin() + truck_ranges_[truck_pos + 1];
+    auto it = std::lower_bound(first, last, order_pos, [](const std::pair<size_t, FreeMovementWeightsRange>& range, size_t order_pos) {
+        return range.first < order_pos;
+    });
+    if (it == last || it->first != order_pos) {
+        return {};
+    }
+    return it->second;
 }
 
-std::optional<double> FreeMovementWeightsVectors::GetWeight(size_t truck_pos, size_t order_pos, unsigned int city_id) const {
-    if (auto raw_vec = GetWeightsVectorConst(truck_pos, order_pos)) {
-        const weights_vector_t& vec = raw_vec.value();
+const FreeMovementWeight& FreeMovementWeightsVectors::GetWeightByPos(size_t weight_pos) const {
+    Sort();
+    return weights_[weight_pos];
+}
 
-        auto it = vec.find(city_id);
-        if (it == vec.end()) {
-            return std::nullopt;
-        }
-        return {it->second};
-    } else {
+std::optional<double> FreeMovementWeightsVectors::GetWeight(size_t truck_pos, size_t order_pos, unsigned int city_id) const {
+    FreeMovementWeightsRange range = GetWeightsVectorConst(truck_pos, order_pos);
+
+    auto first = weights_.begin() + range.first;
+    auto last = weights_.begin() + range.last;
+    auto it = std::lower_bound(first, last, city_id, [](const FreeMovementWeight& w, unsigned int city_id) {
+        return w.city_id < city_id;
+    });
+    if (it == last || it->city_id != city_id) {
         return std::nullopt;
     }
+    return {it->weight};
 }
 
 void FreeMovementWeightsVectors::AddWeight(size_t truck_pos, size_t order_pos, unsigned int city_id, double weight) {
-    if (auto raw_vec = GetWeightsVector(truck_pos, order_pos)) {
-        weights_vector_t& vec = raw_vec.value();
-        // (double)0 is default value so += will work if there is no such element yet
-        vec[city_id] += weight;
-    } else {
-        edges_w_vecs_[{truck_pos, order_pos}][city_id] = weight;
-    }
+    weights_.push_back(FreeMovementWeight{truck_pos, order_pos, city_id, weight});
+    ++unsorted_count_;
+}
+
+void FreeMovementWeightsVectors::AddWeights(const std::vector<FreeMovementWeight>& weights) {
+    weights_.insert(weights_.end(), weights.begin(), weights.end());
+    unsorted_count_ += weights.size();
 }
 
 void FreeMovementWeightsVectors::Reset() {
-    edges_w_vecs_.clear();
+    weights_.clear();
+    ranges_.clear();
+    truck_ranges_.clear();
+    unsorted_count_ = 0;
 }
 
 ////////////
@@ -205,28 +281,122 @@ bool Solver::IsFakeOrder(size_t order_pos) {
     return (order_pos == ffo_pos || order_pos == flo_pos);
 }
 
+Solver::Solver(const SolverOptions& options) : options_(options) {}
+
+void Solver::SetOptions(const SolverOptions& options) {
+    options_ = options;
+}
+
+const SolverOptions& Solver::GetOptions() const {
+    return options_;
+}
+
+uint64_t Solver::GetOrderKey(const Order& order) {
+    if (order.order_id > 0) {
+        return CombineKey(1, order.order_id);
+    }
+    return CombineKey(CombineKey(CombineKey(2, order.from_city), order.to_city), order.start_time);
+}
+
+uint64_t Solver::GetFakeOrderKey(size_t order_pos) {
+    assert(IsFakeOrder(order_pos));
+    return CombineKey(3, order_pos == ffo_pos);
+}
+
+const SolveStats& Solver::GetLastSolveStats() const {
+    return last_solve_stats_;
+}
+
+size_t ResolveThreadsCount(int threads, size_t tasks_count) {
+    size_t threads_count = (threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    return std::max<size_t>(1, std::min(threads_count, tasks_count));
+}
+
+void Solver::ApplyOptions(Highs& highs, const SolverOptions& options) {
+    // HiGHS refuses to run if global scheduler of this thread was initialized with another number of threads
+    static thread_local int scheduler_threads = 0;
+    if (options.threads != 0 && options.threads != scheduler_threads) {
+        Highs::resetGlobalScheduler(true);
+        scheduler_threads = options.threads;
+    }
+
+    // Note: rejected option keeps its old value (HiGHS returns kError) - every option is being checked on its own
+    HighsStatus return_status;
+    // Note: HiGHS run clock is not being reset between runs so time limit is shared by LP and MIP
+    return_status = highs.setOptionValue("time_limit", options.time_limit);
+    assert(return_status==HighsStatus::kOk);
+    return_status = highs.setOptionValue("mip_rel_gap", options.mip_rel_gap);
+    assert(return_status==HighsStatus::kOk);
+    return_status = highs.setOptionValue("threads", options.threads);
+    assert(return_status==HighsStatus::kOk);
+    return_status = highs.setOptionValue("presolve", (options.presolve ? "choose" : "off"));
+    assert(return_status==HighsStatus::kOk);
+}
+
+static bool IsLimitReached(HighsModelStatus model_status) {
+    return model_status == HighsModelStatus::kTimeLimit
+        || model_status == HighsModelStatus::kIterationLimit
+        || model_status == HighsModelStatus::kSolutionLimit
+        || model_status == HighsModelStatus::kInterrupt;
+}
+
+#ifdef DEBUG_MODE
+static std::string StatusToString(SOLUTION_STATUS status) {
+    switch (status) {
+        case SOLUTION_STATUS::OPTIMAL:     return "optimal";
+        case SOLUTION_STATUS::INCUMBENT:   return "incumbent";
+        case SOLUTION_STATUS::NO_SOLUTION: return "no solution";
+    }
+    return "";
+}
+#endif
+
 std::vector<size_t> Solver::Solve(HighsModel& model) {
+    static constexpr double integrality_eps = 1e-6;
+
     std::cout << "Model(" << model.lp_.num_col_ << ',' << model.lp_.num_row_ << ")\n";
+    last_solve_stats_ = SolveStats();
     if (model.lp_.num_col_ == 0) {
         return {};
     }
 
-    Highs highs;
+    HighsStatus return_status;
+
+    // model columns are at other positions in session model
+    Highs local_highs;
+    Highs* highs_ptr = &local_highs;
+    if (options_.persistent_session) {
+        if (!session_) {
+            session_ = std::make_unique<HighsSession>();
+        }
+        highs_ptr = &session_->GetHighs();
+    }
+    Highs& highs = *highs_ptr;
     #ifndef DEBUG_MODE
     highs.setOptionValue("output_flag", false);
     #endif
-    HighsStatus return_status;
-    
-    return_status = highs.passModel(model);
-    assert(return_status==HighsStatus::kOk);
+    ApplyOptions(highs, options_);
+
+    if (options_.persistent_session) {
+        session_->Update(model, model_keys_);
+        last_solve_stats_.incremental = session_->IsLastUpdateIncremental();
+        last_solve_stats_.kept_columns = session_->GetKeptColumnsCount();
+        last_solve_stats_.added_columns = session_->GetAddedColumnsCount();
+    } else {
+        return_status = highs.passModel(model);
+        assert(return_status==HighsStatus::kOk);
+    }
 
     const HighsLp& lp = highs.getLp(); 
 
+    auto lp_start = std::chrono::steady_clock::now();
     return_status = highs.run();
-    assert(return_status==HighsStatus::kOk);
+    // kWarning is returned when some limit is reached
+    assert(return_status!=HighsStatus::kError);
+    last_solve_stats_.lp_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - lp_start).count();
     
     const HighsModelStatus& model_status = highs.getModelStatus();
-    assert(model_status==HighsModelStatus::kOptimal);
+    assert(model_status==HighsModelStatus::kOptimal || IsLimitReached(model_status));
     
     const HighsInfo& info = highs.getInfo();
     #ifdef DEBUG_MODE
@@ -239,22 +409,58 @@ std::vector<size_t> Solver::Solve(HighsModel& model) {
     #endif
     
     const HighsSolution& solution = highs.getSolution();
-    
-    model.lp_.integrality_.resize(lp.num_col_);
-    for (int col=0; col < lp.num_col_; col++)
-        model.lp_.integrality_[col] = HighsVarType::kInteger;
 
-    highs.passModel(model);
-    
-    return_status = highs.run();
-    assert(return_status==HighsStatus::kOk);
+    // for our models LP optimum is very often 0/1 already - then there is nothing left for MIP
+    last_solve_stats_.lp_integral = std::all_of(solution.col_value.begin(), solution.col_value.end(), [](double value) {
+        return std::abs(value - std::round(value)) <= integrality_eps;
+    });
+
+    if (model_status != HighsModelStatus::kOptimal) {
+        // there is no time left for MIP - interrupted LP solution is good only if its integral and feasible
+        bool is_feasible = last_solve_stats_.lp_integral && info.primal_solution_status == kSolutionStatusFeasible;
+        last_solve_stats_.status = (is_feasible ? SOLUTION_STATUS::INCUMBENT : SOLUTION_STATUS::NO_SOLUTION);
+    } else if (!last_solve_stats_.lp_integral) {
+        // same Highs instance (model isnt being passed again), LP solution is being used as starting point
+        HighsSolution lp_solution = solution;
+
+        model.lp_.integrality_.assign(lp.num_col_, HighsVarType::kInteger);
+        if (options_.persistent_session) {
+            session_->MakeIntegral();
+        } else {
+            return_status = highs.changeColsIntegrality(0, lp.num_col_ - 1, model.lp_.integrality_.data());
+            assert(return_status==HighsStatus::kOk);
+        }
+        highs.setSolution(lp_solution);
+
+        auto mip_start = std::chrono::steady_clock::now();
+        return_status = highs.run();
+        assert(return_status!=HighsStatus::kError);
+        last_solve_stats_.mip_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - mip_start).count();
+
+        assert(model_status==HighsModelStatus::kOptimal || IsLimitReached(model_status));
+        if (model_status != HighsModelStatus::kOptimal) {
+            bool is_feasible = info.primal_solution_status == kSolutionStatusFeasible;
+            last_solve_stats_.status = (is_feasible ? SOLUTION_STATUS::INCUMBENT : SOLUTION_STATUS::NO_SOLUTION);
+        }
+    }
+
+    #ifdef DEBUG_MODE
+    std::cout << "Solve path: " << (last_solve_stats_.lp_integral ? "LP (integral)" : "LP -> MIP")
+        << ", lp " << last_solve_stats_.lp_time << "s"
+        << ", mip " << last_solve_stats_.mip_time << "s"
+        << ", " << StatusToString(last_solve_stats_.status) << std::endl;
+    #endif
 
     std::vector<size_t> setted_columns;
+    if (last_solve_stats_.status == SOLUTION_STATUS::NO_SOLUTION) {
+        return setted_columns;
+    }
     setted_columns.reserve(lp.num_col_);
     for (int col = 0; col < lp.num_col_; ++col) {
-        if (info.primal_solution_status && solution.col_value[col]) {
+        int pos = (options_.persistent_session ? session_->GetColumnPos(col) : col);
+        if (info.primal_solution_status && solution.col_value[pos] > 0.5) {
             setted_columns.push_back(col);
         }
     }
     return setted_columns;
-}
\ No newline at end of file
+}
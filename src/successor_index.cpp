@@ -0,0 +1,153 @@
+#include "successor_index.h"
+#include "data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+    void HashCombine(uint64_t& seed, uint64_t v) {
+        seed ^= v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+
+    uint64_t DoubleBits(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+}
+
+#ifdef DEBUG_MODE
+using std::cout;
+using std::endl;
+void SuccessorIndex::DebugPrint() const {
+    cout<<"##SUCCESSOR_INDEX_DEBUG:"<<endl
+        <<"orders is "<<GetOrdersCount()<<endl
+        <<"edges is "<<GetEdgesCount()<<endl
+        <<"SUCCESSOR_INDEX_DEBUG##"<<endl<<endl;
+}
+#endif
+
+uint64_t SuccessorIndex::Fingerprint(const Data& data, size_t orders_count) {
+    assert(orders_count <= data.orders.Size());
+    const Params& params = data.params;
+    uint64_t seed = 0;
+    for (double x : {params.speed, params.free_km_cost, params.free_hour_cost, params.wait_cost, params.duty_km_cost, params.duty_hour_cost}) {
+        HashCombine(seed, DoubleBits(x));
+    }
+    HashCombine(seed, data.GetDistsConst().RoadsCount());
+    HashCombine(seed, data.GetDistsConst().IsDense());
+    for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+        const Order& order = data.orders.GetOrderConst(order_pos);
+        HashCombine(seed, order.start_time);
+        HashCombine(seed, order.finish_time);
+        HashCombine(seed, order.from_city);
+        HashCombine(seed, order.to_city);
+        HashCombine(seed, DoubleBits(order.distance));
+        HashCombine(seed, DoubleBits(order.revenue));
+    }
+    return seed;
+}
+
+bool SuccessorIndex::IsBuiltFor(const Data& data) const {
+    return built_ && GetOrdersCount() == data.orders.Size() && fingerprint_ == Fingerprint(data, data.orders.Size());
+}
+
+void SuccessorIndex::Build(const Data& data, const SuccessorIndex* previous) {
+    assert(previous != this);
+    const Orders& orders = data.orders;
+    const size_t orders_count = orders.Size();
+
+    // rows of 'previous' are still valid if only new orders were appended
+    size_t reused_orders_count = 0;
+    if (previous != nullptr && previous->built_ && previous->GetOrdersCount() <= orders_count
+        && previous->fingerprint_ == Fingerprint(data, previous->GetOrdersCount())) {
+        reused_orders_count = previous->GetOrdersCount();
+    }
+
+    by_start_time_.resize(orders_count);
+    std::iota(by_start_time_.begin(), by_start_time_.end(), 0);
+    std::stable_sort(by_start_time_.begin(), by_start_time_.end(), [&orders](uint32_t a, uint32_t b) {
+        return orders.GetOrderConst(a).start_time < orders.GetOrderConst(b).start_time;
+    });
+
+    std::vector<unsigned int> start_times(orders_count);
+    for (size_t i = 0; i < orders_count; ++i) {
+        start_times[i] = orders.GetOrderConst(by_start_time_[i]).start_time;
+    }
+
+    offsets_.assign(1, 0);
+    offsets_.reserve(orders_count + 1);
+    targets_.clear();
+    revenues_.clear();
+    if (reused_orders_count > 0) {
+        targets_.reserve(previous->GetEdgesCount());
+        revenues_.reserve(previous->GetEdgesCount());
+    }
+
+    std::vector<std::pair<uint32_t, double>> row;
+    for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
+        if (from_order_pos < reused_orders_count) {
+            size_t first_edge = previous->offsets_[from_order_pos];
+            size_t last_edge = previous->offsets_[from_order_pos + 1];
+            targets_.insert(targets_.end(), previous->targets_.begin() + first_edge, previous->targets_.begin() + last_edge);
+            revenues_.insert(revenues_.end(), previous->revenues_.begin() + first_edge, previous->revenues_.begin() + last_edge);
+            // appended orders have greater positions so row stays sorted
+            AddSuccessors(data, from_order_pos, reused_orders_count, start_times, row);
+        } else {
+            AddSuccessors(data, from_order_pos, 0, start_times, row);
+        }
+        offsets_.push_back(targets_.size());
+    }
+
+    fingerprint_ = Fingerprint(data, orders_count);
+    built_ = true;
+
+    #ifdef DEBUG_MODE
+    DebugPrint();
+    #endif
+}
+
+void SuccessorIndex::AddSuccessors(const Data& data, size_t from_order_pos, size_t first_to_order_pos, const std::vector<unsigned int>& start_times, std::vector<std::pair<uint32_t, double>>& row) {
+    const Orders& orders = data.orders;
+    const size_t orders_count = orders.Size();
+    const Order& from_order = orders.GetOrderConst(from_order_pos);
+
+    // only orders which start after from_order finishes are being checked (suffix of by_start_time_)
+    size_t first = std::lower_bound(start_times.begin(), start_times.end(), from_order.finish_time) - start_times.begin();
+    row.clear();
+    for (size_t i = first; i < orders_count; ++i) {
+        uint32_t to_order_pos = by_start_time_[i];
+        if (to_order_pos < first_to_order_pos) {
+            continue;
+        }
+        if (auto revenue = data.MoveBetweenOrders(from_order, orders.GetOrderConst(to_order_pos))) {
+            row.emplace_back(to_order_pos, revenue.value());
+        }
+    }
+    // row is being sorted back by position once (O(degree * log(degree)))
+    std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    for (const auto& [to_order_pos, revenue] : row) {
+        targets_.push_back(to_order_pos);
+        revenues_.push_back(revenue);
+    }
+}
+
+size_t SuccessorIndex::GetOrdersCount() const {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
+
+size_t SuccessorIndex::GetEdgesCount() const {
+    return targets_.size();
+}
+
+size_t SuccessorIndex::GetDegree(size_t order_pos) const {
+    return offsets_[order_pos + 1] - offsets_[order_pos];
+}
+
+const std::vector<uint32_t>& SuccessorIndex::GetOrdersByStartTime() const {
+    return by_start_time_;
+}
@@ -0,0 +1,69 @@
+#include "table_reader.h"
+
+///////////////
+// TableCell //
+///////////////
+
+TableCell::TableCell(const XLSXStreamCell& cell) : cell_(cell) {}
+
+TableCell::TableCell(const CSVCell& cell) : cell_(cell) {}
+
+void TableCell::next() {
+    std::visit([](auto& cell) { cell.next(); }, cell_);
+}
+
+bool TableCell::is_end() const {
+    return std::visit([](const auto& cell) { return cell.is_end(); }, cell_);
+}
+
+XLValueType TableCell::get_type() const {
+    return std::visit([](const auto& cell) { return cell.get_type(); }, cell_);
+}
+
+std::optional<unsigned int> TableCell::get_time_value() const {
+    return std::visit([](const auto& cell) { return cell.get_time_value(); }, cell_);
+}
+
+template<typename T>
+T TableCell::get_value() const {
+    return std::visit([](const auto& cell) { return cell.template get_value<T>(); }, cell_);
+}
+
+template<typename T>
+std::optional<T> TableCell::get_num_value() const {
+    return std::visit([](const auto& cell) { return cell.template get_num_value<T>(); }, cell_);
+}
+
+template std::string TableCell::get_value() const;
+template std::optional<double> TableCell::get_num_value() const;
+template std::optional<unsigned int> TableCell::get_num_value() const;
+
+/////////////////
+// TableReader //
+/////////////////
+
+TableReader::TableReader(const std::string &path) {
+    if (CSVReader::IsCSVPath(path)) {
+        reader_ = std::make_unique<CSVReader>(path);
+    } else {
+        reader_ = std::make_unique<XLSXStreamReader>(path, "Sheet1");
+    }
+}
+
+bool TableReader::NextRow() {
+    return std::visit([](auto& reader) { return reader->NextRow(); }, reader_);
+}
+
+TableCell TableReader::FirstCell() const {
+    return std::visit([](const auto& reader) { return TableCell(reader->FirstCell()); }, reader_);
+}
+
+TableReader::Stats TableReader::GetStats() const {
+    return std::visit([](const auto& reader) { return reader->GetStats(); }, reader_);
+}
+
+#ifdef DEBUG_MODE
+void TableReader::DebugPrintStats(const std::string &name) const {
+    std::visit([&name](const auto& reader) { reader->DebugPrintStats(name); }, reader_);
+}
+#endif
@@ -41,18 +41,16 @@ Truck::Truck(
 
 
 Trucks::Trucks(const std::string &path_to_xlsx) {
-    XLDocument doc;
-    doc.open(path_to_xlsx);
-    auto worksheet = doc.workbook().worksheet("Sheet1");
+    TableReader reader(path_to_xlsx);
 
     bool is_need_skip_header = 1;
-    for (auto& row : worksheet.rows()) {
+    while (reader.NextRow()) {
         if(is_need_skip_header) {
             is_need_skip_header = false;
             continue;
         }
         
-        XLSXcell cell(row.cells().begin());
+        TableCell cell = reader.FirstCell();
         if(cell.get_type()==XLValueType::Empty) {
             break;
         }
@@ -82,6 +80,10 @@ Trucks::Trucks(const std::string &path_to_xlsx) {
             });
         }
     }
+
+    #ifdef DEBUG_MODE
+    reader.DebugPrintStats(path_to_xlsx);
+    #endif
 }
 
 
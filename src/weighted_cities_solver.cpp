@@ -4,7 +4,12 @@
 // WeightedCitiesSolver //
 //////////////////////////
 
-WeightedCitiesSolver::WeightedCitiesSolver() {}
+WeightedCitiesSolver::WeightedCitiesSolver(const SolverOptions& options) : Solver(options), flow_solver(options) {}
+
+void WeightedCitiesSolver::SetOptions(const SolverOptions& options) {
+    Solver::SetOptions(options);
+    flow_solver.SetOptions(options);
+}
 
 const Data& WeightedCitiesSolver::GetDataConst() const {
     return data_;
@@ -34,10 +39,9 @@ void WeightedCitiesSolver::SetData(const Data& data, unsigned int t, const FreeM
 }
 
 HighsModel WeightedCitiesSolver::CreateModel() {
-    Params params = data_.params;
-    Trucks trucks = data_.trucks;
-    Orders orders = data_.orders;    
-    Distances dists = data_.dists;
+    const Params& params = data_.params;
+    const Trucks& trucks = data_.trucks;
+    const Orders& orders = data_.orders;
 
     flow_solver.SetData(data_);
     HighsModel model = flow_solver.CreateModel();
@@ -87,5 +91,7 @@ HighsModel WeightedCitiesSolver::CreateModel() {
 
 solution_t WeightedCitiesSolver::Solve() {
     auto model = CreateModel();
-    return flow_solver.Solve(model);
+    solution_t solution = flow_solver.Solve(model);
+    last_solve_stats_ = flow_solver.GetLastSolveStats();
+    return solution;
 }
\ No newline at end of file
@@ -123,6 +123,19 @@ bool IsExecutableBy(
     return good_load_type & good_trailer_type;
 }
 
+unsigned int GetTimeFromSerial(double serial) {
+    tm t = XLDateTime(serial).tm();
+    return (mktime(&t) + three_hours + 59)/60;
+}
+
+unsigned int GetTimeFromSerialDays(int serial_days) {
+    long long y = (1LL * serial_days * 24 * 60 * 60 - serial_unix_offset);
+    // gmtime_r - files can be parsed concurrently (look Data constructor)
+    tm t;
+    gmtime_r(reinterpret_cast<time_t*>(&y), &t);
+    //std::cout<<ctime(reinterpret_cast<time_t*>(&y))<<std::endl;
+    return (mktime(&t) + three_hours + 59)/60;
+}
 
 XLSXcell::XLSXcell(XLRowDataIterator cell): cell(cell) {}
 
@@ -177,16 +190,12 @@ std::optional<unsigned int> XLSXcell::get_time_value() {
     switch (v.type())
     {
     case XLValueType::Float: {
-        tm t = v.get<XLDateTime>().tm();
-        x = (mktime(&t) + three_hours + 59)/60;
+        x = GetTimeFromSerial(v.get<double>());
         break;
     }
     
     case XLValueType::Integer: {
-        long long y = (1LL * (v.get<int>()) * 24 * 60 * 60 - serial_unix_offset);
-        tm t = *std::gmtime(reinterpret_cast<time_t*>(&y));
-        x = (mktime(&t) + three_hours + 59)/60;
-        //std::cout<<ctime(reinterpret_cast<time_t*>(&y))<<std::endl;
+        x = GetTimeFromSerialDays(v.get<int>());
         break;
     }
 
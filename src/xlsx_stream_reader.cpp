@@ -0,0 +1,647 @@
+#include "xlsx_stream_reader.h"
+
+#include <zippy.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+
+namespace {
+    // size of inflated chunk of XML being processed at once
+    constexpr size_t CHUNK_SIZE = 1 << 16;
+
+    std::string_view LocalName(std::string_view name) {
+        size_t colon = name.find(':');
+        if (colon != std::string_view::npos) {
+            return name.substr(colon + 1);
+        }
+        return name;
+    }
+
+    void AppendUtf8(std::string& out, unsigned long code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    // decoding predefined XML entities and character references
+    void AppendDecoded(std::string& out, std::string_view text) {
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '&') {
+                out += text[i];
+                continue;
+            }
+            size_t semicolon = text.find(';', i);
+            if (semicolon == std::string_view::npos) {
+                out += text[i];
+                continue;
+            }
+            std::string_view entity = text.substr(i + 1, semicolon - i - 1);
+            if (entity == "amp") {
+                out += '&';
+            } else if (entity == "lt") {
+                out += '<';
+            } else if (entity == "gt") {
+                out += '>';
+            } else if (entity == "quot") {
+                out += '"';
+            } else if (entity == "apos") {
+                out += '\'';
+            } else if (!entity.empty() && entity[0] == '#') {
+                std::string code(entity.substr(1));
+                bool is_hex = !code.empty() && (code[0] == 'x' || code[0] == 'X');
+                AppendUtf8(out, std::strtoul(code.c_str() + is_hex, nullptr, is_hex ? 16 : 10));
+            } else {
+                out.append(text.substr(i, semicolon - i + 1));
+            }
+            i = semicolon;
+        }
+    }
+
+    // {column, row} by cell reference ("B12" -> {2, 12})
+    std::pair<size_t, size_t> ParseCellReference(std::string_view ref) {
+        size_t column = 0;
+        size_t i = 0;
+        for (; i < ref.size() && std::isalpha(static_cast<unsigned char>(ref[i])); ++i) {
+            column = column * 26 + (std::toupper(static_cast<unsigned char>(ref[i])) - 'A' + 1);
+        }
+        size_t row = 0;
+        for (; i < ref.size() && std::isdigit(static_cast<unsigned char>(ref[i])); ++i) {
+            row = row * 10 + (ref[i] - '0');
+        }
+        return {column, row};
+    }
+
+    /*
+        Pull tokenizer over XML file inside of zip archive
+        Note: it knows nothing about XML structure, it just splits stream into tags and texts
+    */
+    class XMLStream {
+    public:
+        enum class Event {
+            START,
+            END,
+            TEXT,
+            DONE
+        };
+
+        XMLStream(mz_zip_archive* zip, const std::string& file_name) {
+            state_ = mz_zip_reader_extract_file_iter_new(zip, file_name.c_str(), 0);
+        }
+
+        ~XMLStream() {
+            if (state_ != nullptr) {
+                mz_zip_reader_extract_iter_free(state_);
+            }
+        }
+
+        XMLStream(const XMLStream&) = delete;
+        XMLStream& operator=(const XMLStream&) = delete;
+
+        bool IsOpen() const {
+            return state_ != nullptr;
+        }
+
+        Event Next() {
+            if (pending_end_) {
+                pending_end_ = false;
+                return Event::END;
+            }
+
+            while (true) {
+                if (pos_ >= buf_.size() && !Fill()) {
+                    return Event::DONE;
+                }
+
+                if (buf_[pos_] != '<') {
+                    size_t lt = Find('<');
+                    text_.clear();
+                    AppendDecoded(text_, std::string_view(buf_).substr(pos_, lt - pos_));
+                    pos_ = lt;
+                    return Event::TEXT;
+                }
+
+                size_t gt = Find('>');
+                if (gt == buf_.size()) {
+                    // broken XML - lets just stop here
+                    pos_ = gt;
+                    return Event::DONE;
+                }
+                std::string_view tag = std::string_view(buf_).substr(pos_ + 1, gt - pos_ - 1);
+                pos_ = gt + 1;
+
+                // declarations, comments etc.
+                if (tag.empty() || tag[0] == '?' || tag[0] == '!') {
+                    continue;
+                }
+
+                if (tag[0] == '/') {
+                    name_ = LocalName(tag.substr(1));
+                    attrs_.clear();
+                    return Event::END;
+                }
+
+                if (tag.back() == '/') {
+                    pending_end_ = true;
+                    tag.remove_suffix(1);
+                }
+
+                size_t name_end = 0;
+                while (name_end < tag.size() && !std::isspace(static_cast<unsigned char>(tag[name_end]))) {
+                    ++name_end;
+                }
+                name_ = LocalName(tag.substr(0, name_end));
+                attrs_ = tag.substr(name_end);
+                return Event::START;
+            }
+        }
+
+        // local name of last START/END tag
+        const std::string& Name() const {
+            return name_;
+        }
+
+        // decoded content of last TEXT
+        const std::string& Text() const {
+            return text_;
+        }
+
+        // attribute of last START tag by its local name
+        std::optional<std::string> Attr(std::string_view key) const {
+            std::string_view attrs = attrs_;
+            size_t i = 0;
+            while (i < attrs.size()) {
+                while (i < attrs.size() && std::isspace(static_cast<unsigned char>(attrs[i]))) {
+                    ++i;
+                }
+                size_t eq = attrs.find('=', i);
+                if (eq == std::string_view::npos || eq + 1 >= attrs.size()) {
+                    break;
+                }
+                std::string_view attr_name = attrs.substr(i, eq - i);
+                while (!attr_name.empty() && std::isspace(static_cast<unsigned char>(attr_name.back()))) {
+                    attr_name.remove_suffix(1);
+                }
+
+                size_t quote_pos = eq + 1;
+                while (quote_pos < attrs.size() && std::isspace(static_cast<unsigned char>(attrs[quote_pos]))) {
+                    ++quote_pos;
+                }
+                if (quote_pos >= attrs.size()) {
+                    break;
+                }
+                char quote = attrs[quote_pos];
+                size_t value_end = attrs.find(quote, quote_pos + 1);
+                if (value_end == std::string_view::npos) {
+                    break;
+                }
+
+                if (LocalName(attr_name) == key) {
+                    std::string value;
+                    AppendDecoded(value, attrs.substr(quote_pos + 1, value_end - quote_pos - 1));
+                    return value;
+                }
+                i = value_end + 1;
+            }
+            return std::nullopt;
+        }
+
+    private:
+        mz_zip_reader_extract_iter_state* state_ = nullptr;
+        std::string buf_;
+        size_t pos_ = 0;
+        bool eof_ = false;
+        bool pending_end_ = false;
+
+        std::string name_;
+        std::string text_;
+        // copy of attributes of last START tag (buf_ can be reallocated)
+        std::string attrs_;
+
+        // dropping processed part of buffer and inflating next chunk
+        bool Fill() {
+            if (eof_ || state_ == nullptr) {
+                return false;
+            }
+            buf_.erase(0, pos_);
+            pos_ = 0;
+
+            size_t old_size = buf_.size();
+            buf_.resize(old_size + CHUNK_SIZE);
+            size_t read = mz_zip_reader_extract_iter_read(state_, &buf_[old_size], CHUNK_SIZE);
+            buf_.resize(old_size + read);
+            if (read == 0) {
+                eof_ = true;
+                return false;
+            }
+            return true;
+        }
+
+        // position of 'ch' starting from pos_ (buf_.size() if there is no such symbol till the end of file)
+        size_t Find(char ch) {
+            size_t from = pos_;
+            while (true) {
+                size_t found = buf_.find(ch, from);
+                if (found != std::string::npos) {
+                    return found;
+                }
+                // Fill() drops first pos_ symbols
+                size_t scanned = buf_.size() - pos_;
+                if (!Fill()) {
+                    return buf_.size();
+                }
+                from = pos_ + scanned;
+            }
+        }
+    };
+}
+
+//////////////////////
+// XLSX STREAM CELL //
+//////////////////////
+
+XLSXStreamCell::XLSXStreamCell(const std::vector<XLSXStreamValue>* row, const std::vector<std::string>* shared_strings) :
+    row_(row),
+    shared_strings_(shared_strings) {}
+
+const XLSXStreamValue& XLSXStreamCell::value() const {
+    static const XLSXStreamValue empty;
+    if (is_end()) {
+        return empty;
+    }
+    return (*row_)[pos_];
+}
+
+void XLSXStreamCell::next() {
+    ++pos_;
+}
+
+bool XLSXStreamCell::is_end() const {
+    return pos_ >= row_->size();
+}
+
+XLValueType XLSXStreamCell::get_type() const {
+    return value().type;
+}
+
+template<>
+std::string XLSXStreamCell::get_value() const {
+    const XLSXStreamValue& v = value();
+    if (v.type == XLValueType::String && v.raw.empty() == false && v.raw[0] == 's') {
+        // shared string: "s<index>"
+        size_t ind = std::strtoull(v.raw.c_str() + 1, nullptr, 10);
+        if (ind < shared_strings_->size()) {
+            return (*shared_strings_)[ind];
+        }
+        return "";
+    }
+    if (v.type == XLValueType::String) {
+        // inline string: "i<text>"
+        return v.raw.substr(1);
+    }
+    return v.raw;
+}
+
+template<typename T>
+std::optional<T> XLSXStreamCell::get_num_value() const {
+    const XLSXStreamValue& v = value();
+
+    // same conversions as XLSXcell::get_num_value
+    T x;
+    switch (v.type)
+    {
+    case XLValueType::Float: {
+        x = static_cast<float>(std::strtod(v.raw.c_str(), nullptr));
+        break;
+    }
+
+    case XLValueType::Integer: {
+        x = static_cast<int>(std::strtoll(v.raw.c_str(), nullptr, 10));
+        break;
+    }
+
+    default:
+        #ifdef DEBUG_MODE
+        std::cerr << "not expected type in set_num_value" << std::endl;
+        std::cerr << v.raw << std::endl;
+        #endif
+        return std::nullopt;
+    }
+    return {x};
+}
+
+std::optional<unsigned int> XLSXStreamCell::get_time_value() const {
+    const XLSXStreamValue& v = value();
+
+    int x;
+    switch (v.type)
+    {
+    case XLValueType::Float: {
+        x = GetTimeFromSerial(std::strtod(v.raw.c_str(), nullptr));
+        break;
+    }
+
+    case XLValueType::Integer: {
+        x = GetTimeFromSerialDays(static_cast<int>(std::strtoll(v.raw.c_str(), nullptr, 10)));
+        break;
+    }
+
+    default:
+        #ifdef DEBUG_MODE
+        std::cerr << "not expected type in set_time_value" << std::endl;
+        std::cerr << v.raw << std::endl;
+        #endif
+        return std::nullopt;
+    }
+
+    return {x};
+}
+
+template std::optional<double> XLSXStreamCell::get_num_value() const;
+template std::optional<unsigned int> XLSXStreamCell::get_num_value() const;
+
+////////////////////////
+// XLSX STREAM READER //
+////////////////////////
+
+class XLSXStreamReader::Impl {
+public:
+    mz_zip_archive zip;
+    std::unique_ptr<XMLStream> sheet;
+
+    std::vector<std::string> shared_strings;
+    std::vector<XLSXStreamValue> row;
+
+    // number of row we expect to be the next one (rows are numbered from 1)
+    size_t next_row_number = 1;
+    // row which <row> tag was already read but we still reporting missing rows before it
+    std::optional<size_t> pending_row_number;
+    bool sheet_data_finished = false;
+
+    std::chrono::steady_clock::time_point start_time;
+    size_t rows = 0;
+
+    Impl(const std::string &path_to_xlsx, const std::string &sheet_name) {
+        start_time = std::chrono::steady_clock::now();
+
+        std::memset(&zip, 0, sizeof(zip));
+        if (!mz_zip_reader_init_file(&zip, path_to_xlsx.c_str(), 0)) {
+            std::cerr << "XLSXStreamReader: cant open " << path_to_xlsx << std::endl;
+            exit(1);
+        }
+
+        ReadSharedStrings();
+
+        std::string sheet_path = FindSheetPath(sheet_name);
+        sheet = std::make_unique<XMLStream>(&zip, sheet_path);
+        if (!sheet->IsOpen()) {
+            std::cerr << "XLSXStreamReader: cant find sheet(" << sheet_name << ") in " << path_to_xlsx << std::endl;
+            exit(1);
+        }
+    }
+
+    ~Impl() {
+        sheet.reset();
+        mz_zip_reader_end(&zip);
+    }
+
+    void ReadSharedStrings() {
+        XMLStream stream(&zip, "xl/sharedStrings.xml");
+        if (!stream.IsOpen()) {
+            // there is no strings in the workbook
+            return;
+        }
+
+        bool in_si = false;
+        bool in_t = false;
+        // <rPh> (phonetic hints) are not part of the string
+        bool in_rph = false;
+        for (auto event = stream.Next(); event != XMLStream::Event::DONE; event = stream.Next()) {
+            const std::string& name = stream.Name();
+            if (event == XMLStream::Event::START) {
+                if (name == "si") {
+                    in_si = true;
+                    shared_strings.emplace_back();
+                } else if (name == "t") {
+                    in_t = true;
+                } else if (name == "rPh") {
+                    in_rph = true;
+                }
+            } else if (event == XMLStream::Event::END) {
+                if (name == "si") {
+                    in_si = false;
+                } else if (name == "t") {
+                    in_t = false;
+                } else if (name == "rPh") {
+                    in_rph = false;
+                }
+            } else if (event == XMLStream::Event::TEXT && in_si && in_t && !in_rph) {
+                shared_strings.back() += stream.Text();
+            }
+        }
+    }
+
+    std::string FindSheetPath(const std::string &sheet_name) {
+        std::optional<std::string> relationship_id;
+        {
+            XMLStream stream(&zip, "xl/workbook.xml");
+            for (auto event = stream.Next(); event != XMLStream::Event::DONE; event = stream.Next()) {
+                if (event == XMLStream::Event::START && stream.Name() == "sheet" && stream.Attr("name") == sheet_name) {
+                    relationship_id = stream.Attr("id");
+                    break;
+                }
+            }
+        }
+        if (!relationship_id.has_value()) {
+            return "";
+        }
+
+        XMLStream stream(&zip, "xl/_rels/workbook.xml.rels");
+        for (auto event = stream.Next(); event != XMLStream::Event::DONE; event = stream.Next()) {
+            if (event == XMLStream::Event::START && stream.Name() == "Relationship" && stream.Attr("Id") == relationship_id) {
+                std::string target = stream.Attr("Target").value_or("");
+                if (!target.empty() && target[0] == '/') {
+                    return target.substr(1);
+                }
+                return "xl/" + target;
+            }
+        }
+        return "";
+    }
+
+    // reading <c> ... </c> (opening tag was already read)
+    void ReadCell(size_t default_column) {
+        size_t column = default_column;
+        if (auto ref = sheet->Attr("r")) {
+            column = ParseCellReference(ref.value()).first;
+        }
+        std::optional<std::string> type = sheet->Attr("t");
+
+        bool has_value = false;
+        std::string raw;
+        bool in_v = false;
+        bool in_is = false;
+        for (auto event = sheet->Next(); event != XMLStream::Event::DONE; event = sheet->Next()) {
+            const std::string& name = sheet->Name();
+            if (event == XMLStream::Event::START) {
+                if (name == "v") {
+                    in_v = true;
+                    has_value = true;
+                } else if (name == "is") {
+                    in_is = true;
+                    has_value = true;
+                }
+            } else if (event == XMLStream::Event::END) {
+                if (name == "c") {
+                    break;
+                } else if (name == "v") {
+                    in_v = false;
+                } else if (name == "is") {
+                    in_is = false;
+                }
+            } else if (event == XMLStream::Event::TEXT && (in_v || in_is)) {
+                raw += sheet->Text();
+            }
+        }
+
+        if (column == 0) {
+            return;
+        }
+        if (row.size() < column) {
+            row.resize(column);
+        }
+        XLSXStreamValue& value = row[column - 1];
+
+        // same rules as XLCellValueProxy::type
+        if (!type.has_value() && !has_value) {
+            value.type = XLValueType::Empty;
+        } else if (!type.has_value() || (type == "n" && has_value)) {
+            if (raw.find('.') != std::string::npos || raw.find("E-") != std::string::npos || raw.find("e-") != std::string::npos) {
+                value.type = XLValueType::Float;
+            } else {
+                value.type = XLValueType::Integer;
+            }
+            value.raw = std::move(raw);
+        } else if (type == "s") {
+            value.type = XLValueType::String;
+            value.raw = "s" + raw;
+        } else if (type == "inlineStr" || type == "str") {
+            value.type = XLValueType::String;
+            value.raw = "i" + raw;
+        } else if (type == "b") {
+            value.type = XLValueType::Boolean;
+            value.raw = std::move(raw);
+        } else {
+            value.type = XLValueType::Error;
+            value.raw = std::move(raw);
+        }
+    }
+
+    // reading cells of the row until </row> (opening tag was already read)
+    void ReadRow() {
+        for (auto event = sheet->Next(); event != XMLStream::Event::DONE; event = sheet->Next()) {
+            if (event == XMLStream::Event::START && sheet->Name() == "c") {
+                ReadCell(row.size() + 1);
+            } else if (event == XMLStream::Event::END && sheet->Name() == "row") {
+                break;
+            }
+        }
+    }
+
+    bool NextRow() {
+        row.clear();
+
+        if (!pending_row_number.has_value()) {
+            if (sheet_data_finished) {
+                return false;
+            }
+            // looking for the next <row>
+            for (auto event = sheet->Next();; event = sheet->Next()) {
+                if (event == XMLStream::Event::DONE || (event == XMLStream::Event::END && sheet->Name() == "sheetData")) {
+                    sheet_data_finished = true;
+                    return false;
+                }
+                if (event == XMLStream::Event::START && sheet->Name() == "row") {
+                    size_t row_number = next_row_number;
+                    if (auto r = sheet->Attr("r")) {
+                        row_number = std::strtoull(r.value().c_str(), nullptr, 10);
+                    }
+                    pending_row_number = std::max(row_number, next_row_number);
+                    break;
+                }
+            }
+        }
+
+        ++rows;
+        if (next_row_number < pending_row_number.value()) {
+            // reporting missing row as empty one
+            ++next_row_number;
+            return true;
+        }
+
+        ReadRow();
+        pending_row_number = std::nullopt;
+        ++next_row_number;
+        return true;
+    }
+};
+
+XLSXStreamReader::XLSXStreamReader(const std::string &path_to_xlsx, const std::string &sheet_name) :
+    impl_(std::make_unique<Impl>(path_to_xlsx, sheet_name)) {}
+
+XLSXStreamReader::~XLSXStreamReader() = default;
+
+bool XLSXStreamReader::NextRow() {
+    return impl_->NextRow();
+}
+
+XLSXStreamCell XLSXStreamReader::FirstCell() const {
+    return XLSXStreamCell(&impl_->row, &impl_->shared_strings);
+}
+
+double XLSXStreamReader::Stats::GetRowsPerSecond() const {
+    if (seconds <= 0.) {
+        return 0.;
+    }
+    return rows / seconds;
+}
+
+XLSXStreamReader::Stats XLSXStreamReader::GetStats() const {
+    Stats stats;
+    stats.rows = impl_->rows;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - impl_->start_time).count();
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        stats.peak_rss_kb = usage.ru_maxrss;
+    }
+    return stats;
+}
+
+#ifdef DEBUG_MODE
+void XLSXStreamReader::DebugPrintStats(const std::string &name) const {
+    Stats stats = GetStats();
+    cout << std::fixed << std::setprecision(3)
+        << "##XLSX_STREAM_DEBUG:" << endl
+        << "sheet is " << name << endl
+        << "rows is " << stats.rows << endl
+        << "seconds is " << stats.seconds << endl
+        << "rows/sec is " << stats.GetRowsPerSecond() << endl
+        << "peak_rss_kb is " << stats.peak_rss_kb << endl
+        << "XLSX_STREAM_DEBUG##" << endl << endl;
+}
+#endif
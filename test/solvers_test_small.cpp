@@ -3,6 +3,13 @@
 #include "checker.h"
 #include "batch_solver.h"
 #include "chain_solver.h"
+#include "data_snapshot.h"
+#include "csv_reader.h"
+#include "lagrangian_flow_solver.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
 
 class SmallDataTest : public testing::Test {
 private:
@@ -98,7 +105,7 @@ public:
         SetUpParams(data_.params);
         SetUpTrucks(data_.trucks);
         SetUpOrders(data_.orders);
-        SetUpDistances(data_.dists);
+        SetUpDistances(data_.GetDistsRef());
         data_.cities_count = 7;
 
 
@@ -116,7 +123,7 @@ TEST_F(SmallDataTest, FlowSolverTestBasic) {
     // data_.params.DebugPrint();
     // data_.trucks.DebugPrint();
     // data_.orders.DebugPrint();
-    // data_.dists.DebugPrint();
+    // data_.GetDistsRef().DebugPrint();
 
     solution_t solution = solver.Solve(model);
 
@@ -215,11 +222,372 @@ TEST_F(SmallDataTest, CheckerTest) {
     EXPECT_DOUBLE_EQ(10., revenue_raw.value());
 }
 
+TEST_F(SmallDataTest, DistancesMatrixTest) {
+    Distances sparse = data_.GetDistsConst();
+    data_.GetDistsRef().BuildMatrix(data_.cities_count);
+    ASSERT_TRUE(data_.GetDistsConst().IsDense());
+    EXPECT_TRUE(data_.GetDistsConst().dists.empty()) << "Dense mode suppose to keep roads only in matrix";
+    EXPECT_EQ(sparse.RoadsCount(), data_.GetDistsConst().RoadsCount());
+
+    for (unsigned int from = 0; from <= data_.cities_count + 1; ++from) {
+        for (unsigned int to = 0; to <= data_.cities_count + 1; ++to) {
+            EXPECT_EQ(sparse.GetDistance(from, to), data_.GetDistsConst().GetDistance(from, to)) << "from = " << from << ", to = " << to;
+            EXPECT_EQ(sparse.GetDistance(from, to), data_.GetDistance(from, to)) << "from = " << from << ", to = " << to;
+        }
+    }
+
+    FlowSolver solver;
+    solver.SetData(data_);
+    auto model = solver.CreateModel();
+    solution_t solution = solver.Solve(model);
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Dense distances suppose to produce same solution";
+}
+
+TEST_F(SmallDataTest, CompatibilityIndexTest) {
+    data_.trucks = Trucks({
+        Truck(1, "Полная", "Рефрижератор", 0, 1),
+        Truck(2, "Задняя", "Тент"        , 0, 1),
+        Truck(3, "Полная", "Рефрижератор", 0, 2)
+    });
+    // per-truck extra bits (same as GetFreeMovementEdges does)
+    data_.trucks.GetTruckRef(2).mask_load_type += 2 * (1 << LOAD_TYPE_COUNT);
+    data_.orders.AddOrder(Order(5, false, 0, 1, 1, 2, static_cast<int>(LOAD_TYPE::REAR) + 1 * (1 << LOAD_TYPE_COUNT), 1, 1., 1.));
+    data_.orders.AddOrder(Order(6, false, 0, 1, 1, 2, static_cast<int>(LOAD_TYPE::FULL) + 2 * (1 << LOAD_TYPE_COUNT), 1, 1., 1.));
+    data_.orders.AddOrder(Order(7, false, 0, 1, 1, 2, GetFullMaskLoadType(), GetFullMaskTrailerType(), 1., 1.));
+
+    auto check = [this]() {
+        const CompatibilityIndex& compatibility = data_.GetCompatibility();
+        for (size_t truck_pos = 0; truck_pos < data_.trucks.Size(); ++truck_pos) {
+            const Truck& truck = data_.trucks.GetTruckConst(truck_pos);
+            std::vector<size_t> expected;
+            for (size_t order_pos = 0; order_pos < data_.orders.Size(); ++order_pos) {
+                const Order& order = data_.orders.GetOrderConst(order_pos);
+                bool executable = IsExecutableBy(truck.mask_load_type, truck.mask_trailer_type, order.mask_load_type, order.mask_trailer_type);
+                EXPECT_EQ(executable, compatibility.IsExecutable(truck_pos, order_pos)) << "truck_pos " << truck_pos << " order_pos " << order_pos;
+                if (executable) {
+                    expected.push_back(order_pos);
+                }
+            }
+            std::vector<size_t> executable_orders;
+            compatibility.ForEachExecutableOrder(truck_pos, [&executable_orders](size_t order_pos) {
+                executable_orders.push_back(order_pos);
+            });
+            EXPECT_EQ(expected, executable_orders);
+        }
+    };
+    check();
+    EXPECT_EQ(3u, data_.GetCompatibility().GetTruckClassesCount()) << "Extra bits of truck make its own class";
+
+    // appending orders (as AddWeightsEdges does) + more than 64 orders
+    for (unsigned int order_id = 8; order_id < 100; ++order_id) {
+        data_.orders.AddOrder(Order(order_id, false, 0, 1, 1, 2, static_cast<int>(order_id % 16) + (order_id % 3) * (1 << LOAD_TYPE_COUNT), 1, 1., 1.));
+    }
+    check();
+
+    // changing masks of existing order
+    data_.orders = Orders({Order(1, false, 0, 1, 1, 2, static_cast<int>(LOAD_TYPE::REAR), 1, 1., 1.)});
+    check();
+}
+
+TEST_F(SmallDataTest, SuccessorIndexTest) {
+    auto check = [this]() {
+        const SuccessorIndex& successors = data_.GetSuccessors();
+        const size_t orders_count = data_.orders.Size();
+        ASSERT_EQ(successors.GetOrdersCount(), orders_count);
+
+        size_t edges_count = 0;
+        for (size_t from_order_pos = 0; from_order_pos < orders_count; ++from_order_pos) {
+            const Order& from_order = data_.orders.GetOrderConst(from_order_pos);
+
+            std::vector<std::pair<size_t, double>> expected;
+            for (size_t to_order_pos = 0; to_order_pos < orders_count; ++to_order_pos) {
+                if (auto revenue = data_.MoveBetweenOrders(from_order, data_.orders.GetOrderConst(to_order_pos))) {
+                    expected.push_back({to_order_pos, revenue.value()});
+                }
+            }
+
+            std::vector<std::pair<size_t, double>> actual;
+            successors.ForEachSuccessor(from_order_pos, [&actual](size_t to_order_pos, double revenue) {
+                actual.push_back({to_order_pos, revenue});
+            });
+            EXPECT_EQ(actual, expected) << "from_order_pos=" << from_order_pos;
+            EXPECT_EQ(successors.GetDegree(from_order_pos), expected.size());
+            edges_count += expected.size();
+        }
+        EXPECT_EQ(successors.GetEdgesCount(), edges_count);
+
+        const std::vector<uint32_t>& by_start_time = successors.GetOrdersByStartTime();
+        ASSERT_EQ(by_start_time.size(), orders_count);
+        for (size_t i = 1; i < by_start_time.size(); ++i) {
+            EXPECT_LE(data_.orders.GetOrderConst(by_start_time[i - 1]).start_time, data_.orders.GetOrderConst(by_start_time[i]).start_time);
+        }
+    };
+    check();
+
+    // copies share index until orders change
+    Data copy(data_);
+    EXPECT_EQ(&copy.GetSuccessors(), &data_.GetSuccessors());
+
+    // many orders with same start_time and different finish_time
+    for (unsigned int order_id = 5; order_id < 40; ++order_id) {
+        data_.orders.AddOrder(Order(order_id, false, 100 + (order_id % 4) * 10, 100 + (order_id % 7) * 15, 1 + order_id % 7, 1 + order_id % 5, "Полная", "Рефрижератор", 10., 5.));
+    }
+    check();
+
+    // changing params changes cached revenue
+    data_.params.wait_cost = 1.;
+    check();
+}
+
+TEST_F(SmallDataTest, DataSnapshotTest) {
+    data_.min_timestamp = 0;
+    for (unsigned int city = 1; city <= data_.cities_count; ++city) {
+        data_.GetIdToRealCityRef()[city] = 100 + city;
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() / "small_data_test.snapshot").string();
+    const uint64_t fingerprint = 42;
+    ASSERT_TRUE(DataSnapshot::Write(data_, path, fingerprint));
+
+    EXPECT_FALSE(DataSnapshot::Read(path, fingerprint + 1).has_value()) << "Snapshot with other fingerprint suppose to be outdated";
+
+    auto raw_data = DataSnapshot::Read(path, fingerprint);
+    std::filesystem::remove(path);
+    ASSERT_TRUE(raw_data.has_value());
+    const Data& data = raw_data.value();
+
+    EXPECT_EQ(data_.cities_count, data.cities_count);
+    EXPECT_TRUE(data.GetDistsConst().IsDense()) << "Snapshot of small Data suppose to keep dense matrix";
+    EXPECT_EQ(data_.GetIdToRealCityConst(), data.GetIdToRealCityConst());
+    EXPECT_EQ(data_.GetDistsConst().RoadsCount(), data.GetDistsConst().RoadsCount());
+    for (unsigned int from = 0; from <= data_.cities_count + 1; ++from) {
+        for (unsigned int to = 0; to <= data_.cities_count + 1; ++to) {
+            EXPECT_EQ(data_.GetDistance(from, to), data.GetDistance(from, to)) << "from = " << from << ", to = " << to;
+        }
+    }
+    EXPECT_DOUBLE_EQ(data_.params.wait_cost, data.params.wait_cost);
+    ASSERT_EQ(data_.trucks.Size(), data.trucks.Size());
+    for (size_t truck_pos = 0; truck_pos < data.trucks.Size(); ++truck_pos) {
+        const Truck& expected = data_.trucks.GetTruckConst(truck_pos);
+        const Truck& truck = data.trucks.GetTruckConst(truck_pos);
+        EXPECT_EQ(expected.truck_id, truck.truck_id);
+        EXPECT_EQ(expected.mask_load_type, truck.mask_load_type);
+        EXPECT_EQ(expected.init_time, truck.init_time);
+        EXPECT_EQ(expected.init_city, truck.init_city);
+    }
+    ASSERT_EQ(data_.orders.Size(), data.orders.Size());
+    for (size_t order_pos = 0; order_pos < data.orders.Size(); ++order_pos) {
+        const Order& expected = data_.orders.GetOrderConst(order_pos);
+        const Order& order = data.orders.GetOrderConst(order_pos);
+        EXPECT_EQ(expected.order_id, order.order_id);
+        EXPECT_EQ(expected.obligation, order.obligation);
+        EXPECT_EQ(expected.start_time, order.start_time);
+        EXPECT_EQ(expected.finish_time, order.finish_time);
+        EXPECT_EQ(expected.from_city, order.from_city);
+        EXPECT_EQ(expected.to_city, order.to_city);
+        EXPECT_DOUBLE_EQ(expected.revenue, order.revenue);
+    }
+
+    FlowSolver solver;
+    solver.SetData(data);
+    auto model = solver.CreateModel();
+    solution_t solution = solver.Solve(model);
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Data from snapshot suppose to produce same solution";
+}
+
+TEST_F(SmallDataTest, DataBatchTest) {
+    std::vector<Truck> trucks = {data_.trucks.GetTruck(0)};
+    std::vector<Order> orders = {data_.orders.GetOrder(0), data_.orders.GetOrder(1)};
+
+    Data batch(data_, trucks, orders);
+    EXPECT_EQ(1u, batch.trucks.Size());
+    EXPECT_EQ(2u, batch.orders.Size());
+    EXPECT_EQ(&data_.GetDistsConst(), &batch.GetDistsConst()) << "Batch suppose to share distances";
+    EXPECT_EQ(&data_.GetIdToRealCityConst(), &batch.GetIdToRealCityConst()) << "Batch suppose to share cities map";
+
+    Data copy(batch);
+    EXPECT_EQ(&data_.GetDistsConst(), &copy.GetDistsConst());
+
+    // changing shared distances of one Data doesnt change others
+    copy.GetDistsRef().dists[{1, 1}] = 42.;
+    EXPECT_NE(&data_.GetDistsConst(), &copy.GetDistsConst());
+    EXPECT_EQ(data_.GetDistsConst().dists, batch.GetDistsConst().dists);
+    EXPECT_NE(data_.GetDistsConst().dists, copy.GetDistsConst().dists);
+}
+
+TEST_F(SmallDataTest, FreeMovementWeightsVectorsTest) {
+    FreeMovementWeightsVectors edges_w_vecs;
+    edges_w_vecs.AddWeight(1, 0, 5, 1.);
+    edges_w_vecs.AddWeights({{0, 0, 6, 2.}, {0, 0, 5, 3.}, {0, Solver::ffo_pos, 2, 1.}});
+    edges_w_vecs.AddWeight(0, 0, 6, 0.5);
+
+    // weights of same key are summed
+    EXPECT_DOUBLE_EQ(2.5, edges_w_vecs.GetWeight(0, 0, 6).value());
+    EXPECT_DOUBLE_EQ(3., edges_w_vecs.GetWeight(0, 0, 5).value());
+    EXPECT_FALSE(edges_w_vecs.GetWeight(0, 0, 7).has_value());
+    EXPECT_FALSE(edges_w_vecs.GetWeight(0, 1, 5).has_value());
+    EXPECT_FALSE(edges_w_vecs.GetWeight(2, 0, 5).has_value());
+
+    FreeMovementWeightsRange range = edges_w_vecs.GetWeightsVectorConst(0, 0);
+    ASSERT_EQ(2u, range.last - range.first);
+    EXPECT_EQ(5u, edges_w_vecs.GetWeightByPos(range.first).city_id);
+    EXPECT_EQ(6u, edges_w_vecs.GetWeightByPos(range.first + 1).city_id);
+    EXPECT_TRUE(edges_w_vecs.GetWeightsVectorConst(1, Solver::ffo_pos).Empty());
+
+    // both trucks move from order 0 to city 5 - its same free-movement edge
+    auto [additional_orders, edge_to_pos] = edges_w_vecs.GetFreeMovementEdges(data_);
+    ASSERT_EQ(4u, edge_to_pos.size());
+    EXPECT_EQ(3u, additional_orders.Size());
+    range = edges_w_vecs.GetWeightsVectorConst(1, 0);
+    ASSERT_EQ(1u, range.last - range.first);
+    EXPECT_EQ(edge_to_pos[edges_w_vecs.GetWeightsVectorConst(0, 0).first], edge_to_pos[range.first]);
+    for (size_t weight_pos = 0; weight_pos < edge_to_pos.size(); ++weight_pos) {
+        const Order& order = additional_orders.GetOrderConst(edge_to_pos[weight_pos]);
+        EXPECT_EQ(edges_w_vecs.GetWeightByPos(weight_pos).city_id, order.to_city);
+    }
+
+    edges_w_vecs.Reset();
+    EXPECT_FALSE(edges_w_vecs.IsInitialized());
+    EXPECT_TRUE(edges_w_vecs.GetWeightsVectorConst(0, 0).Empty());
+}
+
+TEST(PreSolverTest, FilteredVariablesTest) {
+    const size_t ffo = Solver::ffo_pos;
+    const size_t flo = Solver::flo_pos;
+    std::vector<variable_t> variables = {
+        {0, ffo, 0}, {0, 0, 1}, {0, 1, flo},  // path of truck 0
+        {0, 2, 1},                           // 2 cant be reached from ffo
+        {0, 1, 3},                           // flo cant be reached from 3
+        {1, 0, 1},                           // truck 1 doesnt have ffo/flo edges
+        {2, ffo, 2}, {2, 2, flo}, {2, ffo, flo}
+    };
+    std::vector<variable_t> expected = {
+        {0, ffo, 0}, {0, 0, 1}, {0, 1, flo},
+        {2, ffo, 2}, {2, 2, flo}, {2, ffo, flo}
+    };
+    EXPECT_EQ(expected, PreSolver(variables).GetFilteredVariables());
+    // more threads than trucks
+    EXPECT_EQ(expected, PreSolver(variables, 8).GetFilteredVariables());
+
+    // deep graph (suppose not to overflow stack)
+    const size_t orders_count = 300000;
+    variables = {{0, ffo, 0}};
+    for (size_t order_pos = 0; order_pos + 1 < orders_count; ++order_pos) {
+        variables.emplace_back(0, order_pos, order_pos + 1);
+    }
+    variables.emplace_back(0, orders_count - 1, flo);
+    EXPECT_EQ(variables.size(), PreSolver(variables).GetFilteredVariables().size());
+
+    // multi-threaded PreSolver suppose to give exactly same variables
+    std::mt19937 rng(7);
+    variables.clear();
+    for (size_t truck_pos = 0; truck_pos < 100; ++truck_pos) {
+        for (size_t i = 0; i < 50; ++i) {
+            size_t order_pos = rng() % 40;
+            switch (rng() % 4) {
+                case 0: variables.emplace_back(truck_pos, ffo, order_pos); break;
+                case 1: variables.emplace_back(truck_pos, order_pos, flo); break;
+                default: variables.emplace_back(truck_pos, order_pos, order_pos + 1 + rng() % 10);
+            }
+        }
+    }
+    std::vector<variable_t> filtered = PreSolver(variables).GetFilteredVariables();
+    EXPECT_FALSE(filtered.empty());
+    for (int threads : {2, 3, 4, 0}) {
+        EXPECT_EQ(filtered, PreSolver(variables, threads).GetFilteredVariables()) << "threads = " << threads;
+    }
+}
+
+TEST(CSVLoadersTest, LocalTimeCacheTest) {
+    LocalTimeCache time_cache;
+    std::tm t{};
+    t.tm_year = 2021 - 1900;
+    for (int isdst : {-1, 0}) {
+        for (int minutes = 0; minutes < 366 * 24 * 60; minutes += 7 * 60 + 13) {
+            t.tm_mon = 0;
+            t.tm_mday = 1 + minutes / (24 * 60);
+            t.tm_hour = minutes / 60 % 24;
+            t.tm_min = minutes % 60;
+            t.tm_sec = minutes % 60;
+            t.tm_isdst = isdst;
+            std::tm normalized = t;
+            mktime(&normalized);
+            normalized.tm_isdst = isdst;
+
+            std::tm expected = normalized;
+            EXPECT_EQ(mktime(&expected), time_cache.MakeTime(normalized));
+        }
+    }
+    EXPECT_EQ(GetTimeFromSerial(44317.58333333334), GetTimeFromSerial(44317.58333333334, time_cache));
+    EXPECT_EQ(GetTimeFromSerialDays(44278), GetTimeFromSerialDays(44278, time_cache));
+}
+
+TEST(CSVLoadersTest, OrdersTest) {
+    std::string path_serial = (std::filesystem::temp_directory_path() / "orders_serial_test.csv").string();
+    std::string path_text = (std::filesystem::temp_directory_path() / "orders_text_test.tsv").string();
+    {
+        std::ofstream out(path_serial);
+        out << "id,obligation,start,finish,from,to,load,trailer,distance,revenue\r\n"
+            << "1,да,44317.58333333334,44318,10,20,Полная,\"Рефрижератор, Тент\",154,0.02773722\r\n"
+            << "2,нет,44317.75,44318.5,20,\"30\",Задняя,Тент,1848.85,0.08467153284671533\r\n"
+            << "3,нет,\"2021-05-01 14:00\",44318.5,20,30,Задняя,Тент,1848.85,1\r\n"
+            << "\r\n"
+            << "4,нет,44317.75,44318.5,20,30,Задняя,Тент,1848.85,1\r\n";
+    }
+    {
+        std::ofstream out(path_text);
+        out << "id\tobligation\tstart\tfinish\tfrom\tto\tload\ttrailer\tdistance\trevenue\n"
+            << "1\tда\t2021-05-01 14:00\t2021-05-02\t10\t20\tПолная\tРефрижератор, Тент\t154\t0.02773722\n";
+    }
+
+    Orders orders_serial(path_serial);
+    Orders orders_text(path_text);
+    std::filesystem::remove(path_serial);
+    std::filesystem::remove(path_text);
+
+    // quotes are only escaping => 2 and 3 are loaded same as unquoted ones, 4 is after empty row
+    ASSERT_EQ(3u, orders_serial.Size());
+    ASSERT_EQ(1u, orders_text.Size());
+    const Order& serial = orders_serial.GetOrderConst(0);
+    const Order& text = orders_text.GetOrderConst(0);
+    EXPECT_EQ(1u, serial.order_id);
+    EXPECT_TRUE(serial.obligation);
+    EXPECT_EQ(GetTimeFromSerial(44317.58333333334), serial.start_time);
+    EXPECT_EQ(GetTimeFromSerialDays(44318), serial.finish_time);
+    EXPECT_EQ(static_cast<double>(static_cast<float>(0.02773722)), serial.revenue) << "Float cells are being read as float (same as xlsx)";
+
+    EXPECT_EQ(serial.order_id, text.order_id);
+    EXPECT_EQ(serial.obligation, text.obligation);
+    EXPECT_EQ(serial.start_time, text.start_time);
+    EXPECT_EQ(serial.finish_time, text.finish_time);
+    EXPECT_EQ(serial.from_city, text.from_city);
+    EXPECT_EQ(serial.to_city, text.to_city);
+    EXPECT_EQ(serial.mask_load_type, text.mask_load_type);
+    EXPECT_EQ(serial.mask_trailer_type, text.mask_trailer_type);
+    EXPECT_EQ(serial.distance, text.distance);
+    EXPECT_EQ(serial.revenue, text.revenue);
+
+    // quoted number and quoted date are same as unquoted ones
+    const Order& quoted_number = orders_serial.GetOrderConst(1);
+    const Order& quoted_date = orders_serial.GetOrderConst(2);
+    EXPECT_EQ(2u, quoted_number.order_id);
+    EXPECT_EQ(quoted_date.to_city, quoted_number.to_city);
+    EXPECT_EQ(3u, quoted_date.order_id);
+    EXPECT_EQ(text.start_time, quoted_date.start_time);
+
+    // empty file (nothing to map) has no rows
+    std::string path_empty = (std::filesystem::temp_directory_path() / "orders_empty_test.csv").string();
+    std::ofstream(path_empty).close();
+    Orders orders_empty(path_empty);
+    std::filesystem::remove(path_empty);
+    EXPECT_EQ(0u, orders_empty.Size());
+}
+
 TEST_F(SmallDataTest, ChainGeneratorNoFreeMovementEdgesTest) {
     ChainGenerator chain_generator(0.f, 4);
     chain_generator.GenerateChains(data_);
 
-    const auto& chains0 = chain_generator.chains_by_truck_pos[0];
+    ChainsSpan chains0 = chain_generator.GetTruckChains(0);
 
     std::vector<std::vector<size_t>> expected0{
         {0},
@@ -231,12 +599,13 @@ TEST_F(SmallDataTest, ChainGeneratorNoFreeMovementEdgesTest) {
     };
     ASSERT_EQ(expected0.size(), chains0.size());
     for (size_t i = 0; i < expected0.size(); ++i) {
+        ASSERT_EQ(expected0[i].size(), chains0[i].size());
         for (size_t j = 0; j < expected0[i].size(); ++j) {
-            EXPECT_EQ(expected0[i][j], chains0[i].chain[j]);
+            EXPECT_EQ(expected0[i][j], chains0[i][j]);
         }
     }
     
-    const auto& chains1 = chain_generator.chains_by_truck_pos[1];
+    ChainsSpan chains1 = chain_generator.GetTruckChains(1);
     ASSERT_EQ(1, chains1.size());
     // {2}
     EXPECT_EQ(2, chains1[0].Back());
@@ -249,12 +618,12 @@ TEST_F(SmallDataTest, ChainGeneratorSingleFreeMovementEdgeTest) {
     size_t old_orders_count = data_.orders.Size();
 
     for (size_t truck_pos = 0; truck_pos < data_.trucks.Size(); ++truck_pos) {
-        const std::vector<Chain>& old_chains = old_chain_generator.chains_by_truck_pos[truck_pos];
+        ChainsSpan old_chains = old_chain_generator.GetTruckChains(truck_pos);
 
         for (size_t chain_pos = 0; chain_pos < old_chains.size(); ++chain_pos) {
-            const Chain& old_chain = old_chains[chain_pos];
-            size_t old_chain_len = old_chain.GetEndPos();
-            size_t last_order_pos = old_chain.chain[old_chain_len - 1];
+            ChainView old_chain = old_chains[chain_pos];
+            size_t old_chain_len = old_chain.size();
+            size_t last_order_pos = old_chain.Back();
             
             // adding edge that suppose to grow current chain
             FreeMovementWeightsVectors edges_w_vecs;
@@ -274,15 +643,18 @@ TEST_F(SmallDataTest, ChainGeneratorSingleFreeMovementEdgeTest) {
             EXPECT_EQ(last_order.finish_time, free_movement_order.start_time);
             EXPECT_EQ(city_id, free_movement_order.to_city);
             
-            const std::vector<Chain>& new_chains = chain_generator.chains_by_truck_pos[truck_pos];
+            ChainsSpan new_chains = chain_generator.GetTruckChains(truck_pos);
             ASSERT_EQ(old_chains.size(), new_chains.size()) << "The number of chains must have remained same";
             /*
                 !!!NOTE!!!
                 we are using here that chain generator saving relative order of chains 
             */
-            const Chain& new_chain = new_chains[chain_pos];
+            ChainView new_chain = new_chains[chain_pos];
             // checking that chain got bigger
-            ASSERT_EQ(old_chain_len + 1, new_chain.GetEndPos()) << "Chain must have lengthened";
+            ASSERT_EQ(old_chain_len + 1, new_chain.size()) << "Chain must have lengthened";
+            for (size_t i = 0; i < old_chain_len; ++i) {
+                EXPECT_EQ(old_chain[i], new_chain[i]);
+            }
             // checking its last order is exactly new free-movement edge
             EXPECT_EQ(data_.orders.Size(), new_chain.Back()) << "Last order must be exactly new free-movement edge";
         }
@@ -295,7 +667,7 @@ TEST_F(SmallDataTest, ChainGeneratorTest) {
 
     const size_t truck_pos = 1;
     const size_t order_pos = 2; 
-    const auto& chains1 = chain_generator.chains_by_truck_pos[truck_pos];
+    ChainsSpan chains1 = chain_generator.GetTruckChains(truck_pos);
     ASSERT_EQ(1, chains1.size());
     EXPECT_EQ(order_pos, chains1[0].Back());
 
@@ -308,7 +680,7 @@ TEST_F(SmallDataTest, ChainGeneratorTest) {
     chain_generator.AddWeightsEdges(data_, edges_w_vecs);
 
     std::set<unsigned int> cities;
-    for (const Chain& chain : chain_generator.chains_by_truck_pos[truck_pos]) {
+    for (ChainView chain : chain_generator.GetTruckChains(truck_pos)) {
         cities.emplace(data_.orders.GetOrderConst(chain.Back()).to_city);
     }
 
@@ -318,6 +690,48 @@ TEST_F(SmallDataTest, ChainGeneratorTest) {
     }
 }
 
+TEST_F(SmallDataTest, ChainGeneratorLongChainsTest) {
+    // orders back and forth between cities 3 and 4 - every later order can go after any earlier one
+    const size_t orders_count = 10;
+    std::vector<Order> orders;
+    for (size_t order_pos = 0; order_pos < orders_count; ++order_pos) {
+        unsigned int start_time = 35 + 100 * order_pos;
+        unsigned int from_city = (order_pos % 2 == 0 ? 3 : 4);
+        orders.emplace_back(order_pos + 1, false, start_time, start_time + 15, from_city, 7 - from_city, "Полная", "Рефрижератор", 10., 40.);
+    }
+    Data data(data_, std::vector<Truck>(data_.trucks.begin(), data_.trucks.end()), orders);
+
+    auto binomial = [](size_t n, size_t k) {
+        size_t result = 1;
+        for (size_t i = 1; i <= k; ++i) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    };
+
+    // length of chains is limited only by mx_chain_len
+    for (size_t mx_chain_len = 1; mx_chain_len <= orders_count + 1; ++mx_chain_len) {
+        ChainGenerator chain_generator(-1e9, mx_chain_len);
+        chain_generator.GenerateChains(data);
+
+        // first truck can start by any order, so every increasing sequence of at most mx_chain_len orders is a chain
+        ChainsSpan chains = chain_generator.GetTruckChains(0);
+        size_t expected_count = 0;
+        for (size_t length = 1; length <= std::min(mx_chain_len, orders_count); ++length) {
+            expected_count += binomial(orders_count, length);
+        }
+        ASSERT_EQ(expected_count, chains.size()) << "mx_chain_len = " << mx_chain_len;
+
+        std::set<std::vector<size_t>> unique_chains;
+        for (ChainView chain : chains) {
+            ASSERT_GE(mx_chain_len, chain.size());
+            EXPECT_TRUE(std::is_sorted(chain.begin(), chain.end()));
+            unique_chains.emplace(chain.begin(), chain.end());
+        }
+        EXPECT_EQ(chains.size(), unique_chains.size()) << "mx_chain_len = " << mx_chain_len;
+    }
+}
+
 TEST_F(SmallDataTest, ChainSolverNoFreeMovementEdgesTest) {
     ChainSolver solver(-1e9, 4);
     solver.SetData(data_);
@@ -337,7 +751,7 @@ TEST_F(SmallDataTest, ChainSolverTest) {
 
         for (unsigned int city_id = 0; city_id < data_.cities_count; ++city_id) {
             // we have to provide free-movement edges between cities with road between them
-            if (!data_.dists.GetDistance(from_city, city_id).has_value()) {
+            if (!data_.GetDistsConst().GetDistance(from_city, city_id).has_value()) {
                 continue;
             }
 
@@ -367,6 +781,318 @@ TEST_F(SmallDataTest, ChainSolverTest) {
     }
 }
 
+TEST_F(SmallDataTest, SolverOptionsTest) {
+    SolverOptions options;
+    options.mip_rel_gap = 0.;
+    options.threads = 1;
+    options.presolve = false;
+
+    FlowSolver flow_solver(options);
+    flow_solver.SetData(data_);
+    solution_t solution = flow_solver.Solve();
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Options without limits suppose to keep ideal solution";
+    EXPECT_EQ(SOLUTION_STATUS::OPTIMAL, solution.status);
+
+    ChainSolver chain_solver(-1e9, 4, options);
+    chain_solver.SetData(data_);
+    solution = chain_solver.Solve();
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Options without limits suppose to keep ideal solution";
+    EXPECT_EQ(SOLUTION_STATUS::OPTIMAL, solution.status);
+
+    // no time for HiGHS at all - batch without solution leaves its trucks idle
+    options.threads = 0;
+    options.batch_time_budget = 0.;
+    std::shared_ptr<WeightedCitiesSolver> solver = std::make_shared<WeightedCitiesSolver>(options);
+    BatchSolver batch_solver(solver);
+
+    solution = batch_solver.Solve(data_, 1000);
+    EXPECT_NE(SOLUTION_STATUS::OPTIMAL, solution.status);
+    ASSERT_EQ(data_.trucks.Size(), solution.orders_by_truck_pos.size());
+    for (const auto& truck_orders : solution.orders_by_truck_pos) {
+        EXPECT_TRUE(truck_orders.empty());
+    }
+    EXPECT_EQ(options.time_limit, solver->GetOptions().time_limit) << "BatchSolver suppose to restore solver options";
+}
+
+TEST_F(SmallDataTest, HighsSessionTest) {
+    SolverOptions options;
+    options.persistent_session = true;
+
+    // same model twice - nothing to add
+    FlowSolver flow_solver(options);
+    flow_solver.SetData(data_);
+    solution_t solution = flow_solver.Solve();
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos);
+    solution = flow_solver.Solve();
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be same solution with kept model";
+    EXPECT_TRUE(flow_solver.GetLastSolveStats().incremental);
+    EXPECT_EQ(0u, flow_solver.GetLastSolveStats().added_columns);
+    EXPECT_LT(0u, flow_solver.GetLastSolveStats().kept_columns);
+
+    // every batch is being solved by previous Highs instance
+    std::shared_ptr<WeightedCitiesSolver> weighted_solver = std::make_shared<WeightedCitiesSolver>(options);
+    BatchSolver flow_batch_solver(weighted_solver);
+    std::shared_ptr<ChainSolver> chain_solver = std::make_shared<ChainSolver>(-1e9, 4, options);
+    BatchSolver chain_batch_solver(chain_solver);
+
+    for (unsigned int time_bound = 5; time_bound <= 300; time_bound += 5) {
+        solution = flow_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+        solution = chain_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+    }
+}
+
+TEST_F(SmallDataTest, PipelineBatchesTest) {
+    SolverOptions options;
+    options.pipeline_batches = true;
+
+    // prefetched batches suppose to give exactly same models as sequential ones
+    std::shared_ptr<WeightedCitiesSolver> weighted_solver = std::make_shared<WeightedCitiesSolver>(options);
+    BatchSolver flow_batch_solver(weighted_solver);
+    std::shared_ptr<ChainSolver> chain_solver = std::make_shared<ChainSolver>(-1e9, 4, options);
+    BatchSolver chain_batch_solver(chain_solver);
+
+    for (unsigned int time_bound = 5; time_bound <= 300; time_bound += 5) {
+        solution_t solution = flow_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+        solution = chain_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+    }
+}
+
+TEST_F(SmallDataTest, ChainColumnGenerationTest) {
+    SolverOptions options;
+    options.chain_column_generation = true;
+
+    // whole data: chains are being priced from chains of one order
+    ChainSolver solver(-1e9, 4, options);
+    solver.SetData(data_);
+    solution_t solution = solver.Solve();
+    EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData";
+
+    // batches: chains also get free-movement edges
+    std::shared_ptr<ChainSolver> chain_solver = std::make_shared<ChainSolver>(-1e9, 4, options);
+    BatchSolver chain_batch_solver(chain_solver);
+    for (unsigned int time_bound = 5; time_bound <= 300; time_bound += 5) {
+        solution = chain_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+    }
+
+    // no time at all - no round is being run and final MIP gets no time either
+    options.time_limit = 0.;
+    ChainSolver limited_solver(-1e9, 4, options);
+    limited_solver.SetData(data_);
+    solution = limited_solver.Solve();
+    EXPECT_NE(SOLUTION_STATUS::OPTIMAL, solution.status);
+    EXPECT_EQ(options.time_limit, limited_solver.GetOptions().time_limit) << "ChainSolver suppose to restore its options";
+}
+
+TEST_F(SmallDataTest, PrepareThreadsTest) {
+    SolverOptions options;
+    // more threads than trucks
+    options.prepare_threads = 4;
+
+    // free-movement weights made by several threads suppose to be same as sequential ones
+    std::shared_ptr<WeightedCitiesSolver> weighted_solver = std::make_shared<WeightedCitiesSolver>(options);
+    BatchSolver flow_batch_solver(weighted_solver);
+    std::shared_ptr<ChainSolver> chain_solver = std::make_shared<ChainSolver>(-1e9, 4, options);
+    BatchSolver chain_batch_solver(chain_solver);
+
+    for (unsigned int time_bound = 5; time_bound <= 300; time_bound += 5) {
+        solution_t solution = flow_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+        solution = chain_batch_solver.Solve(data_, time_bound);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData and time_bound = " << time_bound;
+    }
+}
+
+TEST_F(SmallDataTest, FlowSolverThreadsTest) {
+    SolverOptions options;
+    options.prepare_threads = 1;
+    FlowSolver serial_solver(options);
+    serial_solver.SetData(data_);
+    HighsModel serial_model = serial_solver.CreateModel();
+
+    // variables enumerated by several threads suppose to give same columns in same order
+    for (int threads : {2, 4, 0}) {
+        options.prepare_threads = threads;
+        FlowSolver solver(options);
+        solver.SetData(data_);
+        HighsModel model = solver.CreateModel();
+
+        EXPECT_EQ(serial_model.lp_.col_cost_, model.lp_.col_cost_) << "threads = " << threads;
+        EXPECT_EQ(serial_model.lp_.a_matrix_.start_, model.lp_.a_matrix_.start_) << "threads = " << threads;
+        EXPECT_EQ(serial_model.lp_.a_matrix_.index_, model.lp_.a_matrix_.index_) << "threads = " << threads;
+
+        solution_t solution = solver.Solve(model);
+        EXPECT_EQ(expected_.orders_by_truck_pos, solution.orders_by_truck_pos) << "Suppose to be ideal solution for SmallData";
+    }
+}
+
+TEST_F(SmallDataTest, FlowSolverAggregatedTrucksTest) {
+    // every truck gets a twin - same masks, init_city and init_time but another truck_id
+    std::vector<Truck> trucks;
+    for (const Truck& truck : data_.trucks) {
+        trucks.push_back(truck);
+        trucks.push_back(truck);
+        trucks.back().truck_id += 100;
+    }
+    Data data(data_, trucks, std::vector<Order>(data_.orders.begin(), data_.orders.end()));
+
+    FlowSolver plain_solver;
+    plain_solver.SetData(data);
+    HighsModel plain_model = plain_solver.CreateModel();
+    solution_t plain_solution = plain_solver.Solve(plain_model);
+
+    SolverOptions options;
+    options.aggregate_trucks = true;
+    FlowSolver solver(options);
+    solver.SetData(data);
+    HighsModel model = solver.CreateModel();
+    solution_t solution = solver.Solve(model);
+
+    EXPECT_LT(model.lp_.num_col_, plain_model.lp_.num_col_) << "Twins suppose to share their columns";
+    EXPECT_LT(model.lp_.num_row_, plain_model.lp_.num_row_) << "Twins suppose to share their rows";
+
+    // paths of class are being given to trucks of class - revenue suppose to be the same
+    Checker plain_checker(data);
+    plain_checker.SetSolution(plain_solution);
+    auto plain_revenue = plain_checker.Check();
+    ASSERT_TRUE(plain_revenue.has_value());
+
+    Checker checker(data);
+    checker.SetSolution(solution);
+    auto revenue = checker.Check();
+    ASSERT_TRUE(revenue.has_value());
+    EXPECT_DOUBLE_EQ(plain_revenue.value(), revenue.value());
+}
+
+TEST_F(SmallDataTest, BatchSolverAggregatedTrucksTest) {
+    // trucks of batch are being aggregated too (they dont get own bits in mask_load_type - look FlowSolver::BuildTruckClasses)
+    std::vector<Truck> trucks;
+    for (const Truck& truck : data_.trucks) {
+        trucks.push_back(truck);
+        trucks.push_back(truck);
+        trucks.back().truck_id += 100;
+    }
+    Data data(data_, trucks, std::vector<Order>(data_.orders.begin(), data_.orders.end()));
+
+    SolverOptions options;
+    options.aggregate_trucks = true;
+    BatchSolver plain_batch_solver(std::make_shared<WeightedCitiesSolver>());
+    BatchSolver batch_solver(std::make_shared<WeightedCitiesSolver>(options));
+
+    auto get_revenue = [&data](const solution_t& solution) {
+        Checker checker(data);
+        checker.SetSolution(solution);
+        return checker.Check();
+    };
+
+    // one batch - twins suppose to give same revenue as without aggregation
+    for (unsigned int time_bound : {300u, 1000u}) {
+        auto plain_revenue = get_revenue(plain_batch_solver.Solve(data, time_bound));
+        auto revenue = get_revenue(batch_solver.Solve(data, time_bound));
+        ASSERT_TRUE(plain_revenue.has_value()) << "time_bound = " << time_bound;
+        ASSERT_TRUE(revenue.has_value()) << "time_bound = " << time_bound;
+        EXPECT_DOUBLE_EQ(plain_revenue.value(), revenue.value()) << "time_bound = " << time_bound;
+    }
+
+    // several batches - twins can take different orders than without aggregation (ties) but solution has to be valid
+    for (unsigned int time_bound = 5; time_bound < 300; time_bound += 5) {
+        EXPECT_TRUE(get_revenue(batch_solver.Solve(data, time_bound)).has_value()) << "time_bound = " << time_bound;
+    }
+}
+
+TEST_F(SmallDataTest, LagrangianFlowSolverTest) {
+    for (int threads : {1, 2}) {
+        SolverOptions options;
+        options.prepare_threads = threads;
+        LagrangianFlowSolver solver(100, options);
+        solver.SetData(data_);
+        solution_t solution = solver.Solve();
+
+        Checker checker(data_);
+        checker.SetSolution(solution);
+        auto revenue = checker.Check();
+        ASSERT_TRUE(revenue.has_value());
+        EXPECT_DOUBLE_EQ(10., revenue.value()) << "Suppose to be ideal solution for SmallData, threads = " << threads;
+
+        // bounds suppose to meet on such small data
+        const SolveStats& stats = solver.GetLastSolveStats();
+        EXPECT_EQ(SOLUTION_STATUS::OPTIMAL, stats.status);
+        EXPECT_NEAR(revenue.value(), stats.primal_bound, 1e-6);
+        EXPECT_GE(stats.dual_bound + 1e-6, stats.primal_bound);
+    }
+}
+
+TEST(HighsSessionTest, IncrementalUpdateTest) {
+    // columns: {key, cost, rows keys} - every row is 0 <= sum <= 1, every column is 0 <= x <= 1
+    typedef std::vector<std::tuple<uint64_t, double, std::vector<uint64_t>>> columns_t;
+    auto make_model = [](const std::vector<uint64_t>& rows, const columns_t& columns, ModelKeys& keys) {
+        HighsModel model;
+        ColumnwiseModelBuilder builder(model, ObjSense::kMaximize);
+        for (size_t row = 0; row < rows.size(); ++row) {
+            builder.AddRow(0, 1);
+        }
+        builder.SetColumnsCount(columns.size());
+        for (size_t col = 0; col < columns.size(); ++col) {
+            builder.SetNonZerosCount(col, std::get<2>(columns[col]).size());
+        }
+        builder.AllocateNonZeros();
+        for (size_t col = 0; col < columns.size(); ++col) {
+            const auto& [_, cost, column_rows] = columns[col];
+            builder.SetColumn(col, cost, 0, 1);
+            for (uint64_t row_key : column_rows) {
+                builder.AddNonZero(std::find(rows.begin(), rows.end(), row_key) - rows.begin(), 1);
+            }
+        }
+        builder.Finish();
+        keys.rows = rows;
+        keys.cols.clear();
+        for (const auto& column : columns) {
+            keys.cols.push_back(std::get<0>(column));
+        }
+        return model;
+    };
+    auto solve = [](HighsSession& session, const HighsModel& model, const ModelKeys& keys) {
+        session.Update(model, keys);
+        session.GetHighs().setOptionValue("output_flag", false);
+        session.GetHighs().run();
+        EXPECT_EQ(HighsModelStatus::kOptimal, session.GetHighs().getModelStatus());
+
+        // objective of model columns recomputed through session positions
+        double objective = 0.;
+        for (HighsInt col = 0; col < model.lp_.num_col_; ++col) {
+            objective += model.lp_.col_cost_[col] * session.GetHighs().getSolution().col_value[session.GetColumnPos(col)];
+        }
+        return objective;
+    };
+
+    HighsSession session;
+    ModelKeys keys;
+
+    HighsModel model = make_model({1, 2}, {{10, 1., {1}}, {11, 3., {1, 2}}, {12, 1., {2}}}, keys);
+    EXPECT_DOUBLE_EQ(3., solve(session, model, keys));
+    EXPECT_FALSE(session.IsLastUpdateIncremental());
+
+    // row 1 with its columns is gone, column 12 gets new cost, row 3 and columns 13, 14 are new
+    model = make_model({3, 2}, {{13, 2., {3, 2}}, {12, 2.5, {2}}, {14, 1., {3}}}, keys);
+    EXPECT_DOUBLE_EQ(3.5, solve(session, model, keys));
+    EXPECT_TRUE(session.IsLastUpdateIncremental());
+    EXPECT_EQ(1u, session.GetKeptColumnsCount());
+    EXPECT_EQ(2u, session.GetAddedColumnsCount());
+    EXPECT_EQ(2, session.GetHighs().getNumRow());
+
+    // not unique keys - whole model is being passed (twice)
+    model = make_model({3, 2}, {{13, 2., {3, 2}}, {13, 2.5, {2}}}, keys);
+    EXPECT_DOUBLE_EQ(2.5, solve(session, model, keys));
+    EXPECT_FALSE(session.IsLastUpdateIncremental());
+    model = make_model({3, 2}, {{13, 2., {3, 2}}}, keys);
+    EXPECT_DOUBLE_EQ(2., solve(session, model, keys));
+    EXPECT_FALSE(session.IsLastUpdateIncremental());
+}
+
 TEST_F(SmallDataTest, BatchSolverFlowTestOneBatch) {
     std::shared_ptr<WeightedCitiesSolver> solver = std::make_shared<WeightedCitiesSolver>();
     BatchSolver batch_solver(std::move(solver));
@@ -66,7 +66,7 @@ public:
         SetUpParams(data_.params);
         SetUpTrucks(data_.trucks);
         SetUpOrders(data_.orders);
-        SetUpDistances(data_.dists);
+        SetUpDistances(data_.GetDistsRef());
         data_.cities_count = 4;
 
 